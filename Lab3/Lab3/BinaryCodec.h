@@ -0,0 +1,71 @@
+#ifndef BINARY_CODEC_H
+#define BINARY_CODEC_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+using namespace std;
+
+// BinaryCodec class template
+//
+// Converts items to and from the bytes used by the binary save and load
+// of the trees. Trivially copyable types are stored as their raw bytes
+// (native byte order) and strings as a 64-bit length followed by the
+// characters. Specialize BinaryCodec to store other types.
+//
+// ******************MEMBERS*******************************
+// size_t fixedSize       --> Bytes per item, or 0 if the size varies
+// void write( buf, x )   --> Append the bytes of x to string buf
+// bool read( p, end, x ) --> Read x from [p, end) and advance p;
+//                            return false if the bytes run out
+
+template <typename T, typename Enable = void>
+struct BinaryCodec;
+
+template <typename T>
+struct BinaryCodec<T, typename enable_if<is_trivially_copyable<T>::value>::type>
+{
+	static const size_t fixedSize = sizeof(T);
+
+	static void write(string & buf, const T & x)
+	{
+		buf.append(reinterpret_cast<const char*>(&x), sizeof(T));
+	}
+
+	static bool read(const char* & p, const char *end, T & x)
+	{
+		if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+		memcpy(&x, p, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+};
+
+template <>
+struct BinaryCodec<string>
+{
+	static const size_t fixedSize = 0;
+
+	static void write(string & buf, const string & x)
+	{
+		uint64_t n = x.size();
+		buf.append(reinterpret_cast<const char*>(&n), sizeof(n));
+		buf.append(x);
+	}
+
+	static bool read(const char* & p, const char *end, string & x)
+	{
+		uint64_t n;
+		if (static_cast<size_t>(end - p) < sizeof(n)) return false;
+		memcpy(&n, p, sizeof(n));
+		p += sizeof(n);
+
+		if (static_cast<uint64_t>(end - p) < n) return false;
+		x.assign(p, static_cast<size_t>(n));
+		p += n;
+		return true;
+	}
+};
+
+#endif
@@ -2,42 +2,205 @@
 #define BINARY_SEARCH_TREE_H
 
 #include "dsexceptions.h"
+#include "BinaryCodec.h"
+#include "NodeHashIndex.h"
+#include "TaskPool.h"
 #include <algorithm>
 #include <string>
 #include <cmath>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <fstream>
+#include <iterator>
+#include <cstdint>
 using namespace std;
 
 // BinarySearchTree class
 //
-// CONSTRUCTION: zero parameter
+// CONSTRUCTION: zero parameter, or a range [first, last) of items
+//
+// Items are ordered by Compare (operator< by default). When Compare is
+// transparent (has is_transparent, like std::less<>), contains, lower_bound,
+// remove and get_parent also accept any key type comparable with Comparable,
+// e.g. a string_view probe into a BinarySearchTree<string>.
+//
+// When OrderStatistics is true, every node also stores the size of its
+// subtree, which gives rank, select and count_range in O(height).
+//
+// When Hash is not void, a hash index from items to nodes is kept next to
+// the tree, and contains answers in O(1) expected time, returning the same
+// iterator. Hash must hash equivalent items equally; a transparent contains
+// uses the index only if Hash accepts the key type. insert, remove and
+// erase_range keep the index up to date; assign, load, split, join and the
+// set operations rebuild it in O(n). Ordered queries still use the tree.
+//
+// In the Splay and SemiSplay access modes, contains and insert move the
+// accessed node toward the root by rotations, so frequently used items
+// stay near the top. Nodes are never moved in memory, so iterators stay
+// valid, but contains then modifies the tree and must not run concurrently
+// with any other operation on it.
+//
+// Items are never copied or moved once stored: remove relinks nodes
+// instead, so iterators to all other items stay valid, and emplace builds
+// an item in its node. Move-only items can be stored with emplace and the
+// move version of insert.
 //
 // ******************PUBLIC OPERATIONS*********************
+// void assign( b, e )    --> Replace contents with the items in [b, e)
 // void insert( x )       --> Insert x
+// BiIterator insert( hint, x ) --> Insert x, searching from hint; return iterator to x
+// pair<BiIterator, bool> emplace( args )  --> Insert an item built from args
+// pair<BiIterator, bool> try_emplace( k, args ) --> Same, but only built if k is absent
 // void remove( x )       --> Remove x
-// bool contains( x )     --> Return true if x is present
+// BiIterator contains( x )    --> Return iterator to x, or end( )
+// BiIterator find( from, x )   --> Same, searching from the iterator from
+// BiIterator lower_bound( x ) --> Return iterator to first item not less than x
+// BiIterator upper_bound( x ) --> Return iterator to first item greater than x
+// Range range( lo, hi )       --> Return the items in [lo, hi], in sorted order
+// contains_batch( b, e, out )    --> Write contains( k ) for each key k in [b, e) to out
+// lower_bound_batch( b, e, out ) --> Same for lower_bound
+// size_t erase_range( lo, hi ) --> Remove the items in [lo, hi]
 // Comparable findMin( )  --> Return smallest item
 // Comparable findMax( )  --> Return largest item
 // boolean isEmpty( )     --> Return true if empty; else false
 // void makeEmpty( )      --> Remove all items
 // void printTree( )      --> Print tree in sorted order
+// void setAccessMode( m ) --> Select Static (default), Splay or SemiSplay
+// bool save( out )       --> Write the tree in binary to a stream or file
+// bool load( in )        --> Replace the tree by one read with save
+// bool load( data, size ) --> Same, from size bytes in memory
+// load( t, fileName ) in BinarySearchTreeIO.h loads a memory-mapped file.
+// TreeStats stats( )     --> Return node count, height, depth histogram, ...
+// The batch lookups advance BatchWidth searches in lock-step, one level per
+// round, and prefetch the next node of each, so the cache misses of
+// independent searches overlap instead of stalling one at a time. They pay
+// off on trees much larger than the cache. They never restructure the tree,
+// whatever the access mode.
+// The hinted insert and find start at an existing item (a finger) and walk
+// the level links, which join every node to its in-order neighbours, toward
+// x; a search from the root runs in lock-step, and the first to find the
+// place of x wins. For d items between the finger and x, this costs
+// O(min(d, height)) however unbalanced the tree, so inserting nearly sorted
+// keys with the previous item as hint is O(1) per key. An x greater than the
+// largest item is linked below it at once, whatever the hint. A hint of
+// end( ) searches from the root.
+// ******************SET OPERATIONS************************
+// Tree split( x )           --> Move the items not less than x to a new tree
+// Tree join( l, r )         --> Concatenate l and r; all of l must be less than r
+// void union_with( t )      --> Add the items of t
+// void intersect_with( t )  --> Keep only the items also in t
+// void difference_with( t ) --> Remove the items that are in t
+// The set operations take the other tree by value and reuse its nodes;
+// pass it with std::move to avoid a copy. union, intersection and difference
+// split one tree around the root of the other and recurse on both halves in
+// parallel; for balanced trees of sizes m <= n this is O(m log(n/m + 1)) work.
+// Only the top few levels recurse, forking one half to the shared TaskPool
+// (TaskPool.h); below them an explicit stack is used, so degenerate trees
+// are safe.
+// ******************ORDER STATISTICS (OrderStatistics = true)*****
+// size_t size( )               --> Return number of items
+// size_t rank( x )             --> Return number of items less than x
+// BiIterator select( k )       --> Return iterator to k-th smallest item (k from 0)
+// size_t count_range( lo, hi ) --> Return number of items in [lo, hi]
+// ******************INSTRUMENTATION***********************
+// Compile with BST_INSTRUMENTATION defined to count, per thread, the
+// comparisons made by contains, insert and remove and the pointers
+// followed by BiIterator steps; read them with bst_counters( ).
 // ******************ERRORS********************************
 // Throws UnderflowException as warranted
+// join throws IllegalArgumentException if the trees overlap
+
+// Shape and size of a tree, as reported by BinarySearchTree::stats( )
+struct TreeStats
+{
+	size_t nodeCount = 0;
+	size_t height = 0;             // number of levels; 0 for an empty tree
+	size_t minimalHeight = 0;      // height of a perfectly balanced tree of nodeCount nodes
+	size_t maxDepth = 0;           // depth of the deepest node; the root has depth 0
+	double averageDepth = 0;
+	vector<size_t> depthHistogram; // depthHistogram[d] = number of nodes at depth d
+	size_t memoryBytes = 0;        // tree object, nodes and hash index, excluding memory owned by the items
+};
+
+#ifdef BST_INSTRUMENTATION
+// Operation counters, kept per thread when BST_INSTRUMENTATION is defined
+struct BSTCounters
+{
+	size_t comparisons = 0;          // all comparisons made while searching
+	size_t containsCalls = 0;
+	size_t containsComparisons = 0;
+	size_t insertCalls = 0;
+	size_t insertComparisons = 0;
+	size_t removeCalls = 0;
+	size_t removeComparisons = 0;
+	size_t iteratorSteps = 0;        // BiIterator ++ and --
+	size_t iteratorHops = 0;         // pointers followed by those steps
+
+	void reset()
+	{
+		*this = BSTCounters{ };
+	}
+};
+
+inline BSTCounters & bst_counters()
+{
+	static thread_local BSTCounters counters;
+	return counters;
+}
+
+#define BST_COUNT(field, n) (bst_counters().field += (n))
+#define BST_MEASURE(op) CountComparisons measure_{ bst_counters().op##Calls, bst_counters().op##Comparisons }
+#else
+#define BST_COUNT(field, n) ((void)0)
+#define BST_MEASURE(op) ((void)0)
+#endif
 
-template <typename Comparable>
+// Hint that the node at p will be read soon
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define BST_PREFETCH(p) _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#define BST_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define BST_PREFETCH(p) ((void)0)
+#endif
+
+// Subtree size kept in each node when order statistics are enabled
+template <bool Enabled>
+struct SubtreeSize
+{
+};
+
+template <>
+struct SubtreeSize<true>
+{
+	size_t size = 1;
+};
+
+template <typename Comparable, typename Compare = less<>, bool OrderStatistics = false, typename Hash = void>
 class BinarySearchTree
 {
-	struct BinaryNode
+	struct BinaryNode : SubtreeSize<OrderStatistics>
 	{
 		Comparable element;
 		BinaryNode *left;
 		BinaryNode *right;
 		BinaryNode *parent;
+		BinaryNode *prev = nullptr;  // level links: the in-order neighbours,
+		BinaryNode *next = nullptr;  // nullptr at the ends
 
 		BinaryNode(const Comparable & theElement, BinaryNode *lt, BinaryNode *rt, BinaryNode *pt)
 			: element{ theElement }, left{ lt }, right{ rt }, parent{ pt } { }
 
 		BinaryNode(Comparable && theElement, BinaryNode *lt, BinaryNode *rt, BinaryNode *pt)
 			: element{ std::move(theElement) }, left{ lt }, right{ rt }, parent{ pt } { }
+
+		// Leaf whose element is constructed in place from args
+		template <typename... Args>
+		BinaryNode(piecewise_construct_t, BinaryNode *pt, Args && ... args)
+			: element(std::forward<Args>(args)...), left{ nullptr }, right{ nullptr }, parent{ pt } { }
 	};
 
 public:
@@ -67,36 +230,34 @@ public:
 
 		BiIterator& operator++()
 		{
-			BinaryNode *prev = current;
+			BST_COUNT(iteratorSteps, 1);
 			current = find_successor(current);
-			if (prev == current) *this = BiIterator();
 			return *this;
 		}
 
 		BiIterator operator++(int)
 		{
-			BinaryNode *prev = current;
-			current = find_successor(current);
-			if (prev == current) *this = BiIterator();
-			return *this;
+			BiIterator old = *this;
+			++*this;
+			return old;
 		}
 
 		BiIterator& operator--()
 		{
-			BinaryNode *prev = current;
+			BST_COUNT(iteratorSteps, 1);
 			current = find_predecessor(current);
-			if (prev == current) *this = BiIterator();
 			return *this;
 		}
 
 		BiIterator operator--(int)
 		{
-			BinaryNode *prev = current;
-			current = find_predecessor(current);
-			if (prev == current) *this = BiIterator();
-			return *this;
+			BiIterator old = *this;
+			--*this;
+			return old;
 		}
 	private:
+		friend class BinarySearchTree;
+
 		BinaryNode *current;
 	};
 
@@ -110,6 +271,36 @@ public:
 		return BiIterator();
 	}
 
+	/**
+	 * Half-open iterator range, usable in a range-based for loop.
+	 */
+	class Range
+	{
+	public:
+		Range(BiIterator b, BiIterator e) : first{ b }, last{ e } { }
+
+		BiIterator begin() const
+		{
+			return first;
+		}
+		BiIterator end() const
+		{
+			return last;
+		}
+	private:
+		BiIterator first;
+		BiIterator last;
+	};
+
+	/**
+	 * How the tree adapts to lookups.
+	 * Static:    the shape only changes on insert and remove
+	 * Splay:     each accessed node is splayed to the root
+	 * SemiSplay: each accessed node is semi-splayed, which roughly halves
+	 *            its depth with fewer rotations than a full splay
+	 */
+	enum class AccessMode { Static, Splay, SemiSplay };
+
 	BinarySearchTree() : root{ nullptr }
 	{
 	}
@@ -117,18 +308,34 @@ public:
 	/**
 	 * Copy constructor
 	 */
-	BinarySearchTree(const BinarySearchTree & rhs) : root{ nullptr }
+	BinarySearchTree(const BinarySearchTree & rhs) : root{ nullptr }, comp{ rhs.comp }, mode{ rhs.mode }
 	{
 		root = clone(rhs.root);
-		clone_parents(root, nullptr);
+		link_subtree(root);
+		index.rebuild(root);
+	}
+
+	/**
+	 * Range constructor: build a balanced tree from the items in [first, last).
+	 * Duplicates are ignored. If parallel is true, large inputs are sorted
+	 * using all hardware threads.
+	 */
+	template <typename InputIterator, typename = typename enable_if<is_convertible<
+		typename iterator_traits<InputIterator>::iterator_category, input_iterator_tag>::value>::type>
+	BinarySearchTree(InputIterator first, InputIterator last, bool parallel = false) : root{ nullptr }
+	{
+		assign(first, last, parallel);
 	}
 
 	/**
 	 * Move constructor
 	 */
-	BinarySearchTree(BinarySearchTree && rhs) : root{ rhs.root }
+	BinarySearchTree(BinarySearchTree && rhs)
+		: root{ rhs.root }, comp{ rhs.comp }, mode{ rhs.mode }, index{ std::move(rhs.index) }, maxNode{ rhs.maxNode }
 	{
 		rhs.root = nullptr;
+		rhs.index.clear();
+		rhs.maxNode = nullptr;
 	}
 
 	/**
@@ -146,10 +353,57 @@ public:
 	BinarySearchTree & operator=(BinarySearchTree _copy)
 	{
 		std::swap(root, _copy.root);
+		std::swap(comp, _copy.comp);
+		std::swap(mode, _copy.mode);
+		std::swap(index, _copy.index);
+		std::swap(maxNode, _copy.maxNode);
 		return *this;
 	}
 
 
+	/**
+	 * Replace the contents of the tree with the items in [first, last).
+	 * The items are sorted (unless already sorted) and deduplicated, and a
+	 * perfectly balanced tree is then built from them in linear time.
+	 */
+	template <typename InputIterator, typename = typename enable_if<is_convertible<
+		typename iterator_traits<InputIterator>::iterator_category, input_iterator_tag>::value>::type>
+	void assign(InputIterator first, InputIterator last, bool parallel = false)
+	{
+		vector<Comparable> items(first, last);
+
+		if (!std::is_sorted(items.begin(), items.end(), comp))
+		{
+			if (parallel)
+			{
+				parallel_sort(items, comp);
+			}
+			else
+			{
+				std::sort(items.begin(), items.end(), comp);
+			}
+		}
+
+		auto equivalent = [this](const Comparable & a, const Comparable & b) { return !comp(a, b); };
+		items.erase(std::unique(items.begin(), items.end(), equivalent), items.end());
+
+		BinaryNode *t = nullptr;
+		try
+		{
+			t = build_balanced(items, 0, items.size(), nullptr);
+		}
+		catch (...)
+		{
+			makeEmpty(t);
+			throw;
+		}
+
+		makeEmpty();
+		root = t;
+		link_subtree(root);
+		index.rebuild(root);
+	}
+
 	/**
 	 * Find the smallest item in the tree.
 	 * Throw UnderflowException if empty.
@@ -179,11 +433,98 @@ public:
 	}
 
 	/**
-	 * Returns true if x is found in the tree.
+	 * Return an iterator to x if it is found in the tree, otherwise end().
 	 */
 	BiIterator contains(const Comparable & x) const
 	{
-		return BiIterator(contains(x, root));
+		BST_MEASURE(contains);
+		return BiIterator(find_node(x));
+	}
+
+	/**
+	 * Heterogeneous version of contains, for transparent comparators only.
+	 */
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	BiIterator contains(const K & x) const
+	{
+		BST_MEASURE(contains);
+		return BiIterator(find_node(x));
+	}
+
+	/**
+	 * Return an iterator to the first item that is not less than x,
+	 * or end() if there is none.
+	 */
+	BiIterator lower_bound(const Comparable & x) const
+	{
+		return BiIterator(lower_bound(x, root));
+	}
+
+	/**
+	 * Heterogeneous version of lower_bound, for transparent comparators only.
+	 */
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	BiIterator lower_bound(const K & x) const
+	{
+		return BiIterator(lower_bound(x, root));
+	}
+
+	/**
+	 * Return an iterator to the first item that is greater than x,
+	 * or end() if there is none.
+	 */
+	BiIterator upper_bound(const Comparable & x) const
+	{
+		BinaryNode *t = root;
+		BinaryNode *result = nullptr;
+
+		while (t != nullptr)
+		{
+			if (comp(x, t->element))
+			{
+				result = t;
+				t = t->left;
+			}
+			else
+			{
+				t = t->right;
+			}
+		}
+
+		return BiIterator(result);
+	}
+
+	static const size_t BatchWidth = 16;
+
+	/**
+	 * Look up each key in the forward range [first, last) and write
+	 * the iterator contains( key ) would return to result, in order.
+	 * Return the end of the output.
+	 */
+	template <typename ForwardIterator, typename OutputIterator>
+	OutputIterator contains_batch(ForwardIterator first, ForwardIterator last, OutputIterator result) const
+	{
+		return search_batch(first, last, result, false);
+	}
+
+	/**
+	 * Write lower_bound( key ) for each key in the forward range
+	 * [first, last) to result, in order. Return the end of the output.
+	 */
+	template <typename ForwardIterator, typename OutputIterator>
+	OutputIterator lower_bound_batch(ForwardIterator first, ForwardIterator last, OutputIterator result) const
+	{
+		return search_batch(first, last, result, true);
+	}
+
+	/**
+	 * Return the items x with lo <= x <= hi, in sorted order.
+	 * Finding the range costs O(height); iterating over its k items O(k + height).
+	 */
+	Range range(const Comparable & lo, const Comparable & hi) const
+	{
+		if (comp(hi, lo)) return Range(end(), end());
+		return Range(lower_bound(lo), upper_bound(hi));
 	}
 
 	Comparable get_parent(const Comparable & x) const
@@ -194,6 +535,15 @@ public:
 		return Comparable{};
 	}
 
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	Comparable get_parent(const K & x) const
+	{
+		BinaryNode* t = (contains(x, root));
+		if (t != nullptr && t->parent != nullptr)
+			return t->parent->element;
+		return Comparable{};
+	}
+
 	void find_pred_succ(const Comparable& x, Comparable& pred, Comparable& suc)
 	{
 		BinaryNode* t = contains(x, root);
@@ -205,367 +555,1987 @@ public:
 			t = contains(x, root);
 
 			temp = find_successor(t);
-			if (findMax(root)->element < x) temp = nullptr;
+			if (comp(findMax(root)->element, x)) temp = nullptr;
 			suc = (temp != nullptr) ? temp->element : Comparable{};
 
 			temp = find_predecessor(t);
-			if (findMin(root)->element > x) temp = nullptr;
+			if (comp(x, findMin(root)->element)) temp = nullptr;
 			pred = (temp != nullptr) ? temp->element : Comparable{};
 
 			remove(x);
 		}
 		else
 		{
-			suc = find_successor(t)->element;
-			pred = find_predecessor(t)->element;
+			temp = find_successor(t);
+			suc = (temp != nullptr) ? temp->element : x;
+			temp = find_predecessor(t);
+			pred = (temp != nullptr) ? temp->element : x;
 		}
 
 	}
 
 	/**
-	 * Test if the tree is logically empty.
-	 * Return true if empty, false otherwise.
+	 * Select how the tree adapts to lookups; see AccessMode.
 	 */
-	bool isEmpty() const
+	void setAccessMode(AccessMode m)
 	{
-		return root == nullptr;
+		mode = m;
+	}
+
+	AccessMode accessMode() const
+	{
+		return mode;
 	}
 
 	/**
-	 * Print the tree contents in sorted order.
+	 * Return the number of items in the tree.
 	 */
-	void printTree(ostream & out = cout) const
+	size_t size() const
 	{
-		if (isEmpty())
-		{
-			out << "Empty tree" << endl;
-		}
-		else
-		{
-			printTree(root, out, "");
-		}
+		static_assert(OrderStatistics, "size() requires OrderStatistics = true");
+		return size_of(root);
 	}
 
 	/**
-	 * Make the tree logically empty.
+	 * Return the number of items less than x.
 	 */
-	void makeEmpty()
+	size_t rank(const Comparable & x) const
 	{
-		root = makeEmpty(root);
+		static_assert(OrderStatistics, "rank() requires OrderStatistics = true");
+		return count_less(x, false);
 	}
 
 	/**
-	 * Insert x into the tree; duplicates are ignored.
+	 * Return an iterator to the k-th smallest item, counting from 0,
+	 * or end() if the tree has k or fewer items.
 	 */
-	void insert(const Comparable & x)
+	BiIterator select(size_t k) const
 	{
-		root = insert(x, root, nullptr);
+		static_assert(OrderStatistics, "select() requires OrderStatistics = true");
+		BinaryNode *t = root;
+
+		while (t != nullptr)
+		{
+			size_t leftSize = size_of(t->left);
+
+			if (k < leftSize)
+			{
+				t = t->left;
+			}
+			else if (k > leftSize)
+			{
+				k -= leftSize + 1;
+				t = t->right;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		return BiIterator(t);
 	}
 
 	/**
-	 * Insert x into the tree; duplicates are ignored.
+	 * Return the number of items x with lo <= x <= hi.
 	 */
-	void insert(Comparable && x)
+	size_t count_range(const Comparable & lo, const Comparable & hi) const
 	{
-		root = insert(std::move(x), root, nullptr);
+		static_assert(OrderStatistics, "count_range() requires OrderStatistics = true");
+		if (comp(hi, lo)) return 0;
+		return count_less(hi, true) - count_less(lo, false);
 	}
 
 	/**
-	 * Remove x from the tree. Nothing is done if x is not found.
+	 * Test if the tree is logically empty.
+	 * Return true if empty, false otherwise.
 	 */
-	void remove(const Comparable & x)
+	bool isEmpty() const
 	{
-		root = remove(x, root);
+		return root == nullptr;
 	}
 
-private:
-	BinaryNode *root;
+	/**
+	 * Write the tree in binary: a header, then two shape bits per node
+	 * (has left child, has right child) and then the items, both in
+	 * pre-order. Items are encoded with BinaryCodec.
+	 * Return true if the whole tree was written.
+	 */
+	bool save(ostream & out) const
+	{
+		string shape;
+		uint64_t count = 0;
+		unsigned char bits = 0;
+
+		for_each_preorder([&](BinaryNode *t) {
+			unsigned shift = (count % 4) * 2;
+			if (t->left != nullptr) bits |= 1u << shift;
+			if (t->right != nullptr) bits |= 2u << shift;
+			if (++count % 4 == 0)
+			{
+				shape.push_back(static_cast<char>(bits));
+				bits = 0;
+			}
+		});
+		if (count % 4 != 0) shape.push_back(static_cast<char>(bits));
+
+		string buf(saveMagic, sizeof(saveMagic));
+		uint32_t keySize = static_cast<uint32_t>(BinaryCodec<Comparable>::fixedSize);
+		buf.append(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+		buf.append(reinterpret_cast<const char*>(&count), sizeof(count));
+		out.write(buf.data(), buf.size());
+		out.write(shape.data(), shape.size());
+		buf.clear();
+
+		for_each_preorder([&](BinaryNode *t) {
+			BinaryCodec<Comparable>::write(buf, t->element);
+			if (buf.size() >= (1 << 16))
+			{
+				out.write(buf.data(), buf.size());
+				buf.clear();
+			}
+		});
+		out.write(buf.data(), buf.size());
 
+		return static_cast<bool>(out);
+	}
 
+	bool save(const string & fileName) const
+	{
+		ofstream out(fileName, ios::binary);
+		return out && save(out);
+	}
 
 	/**
-	 * Private member function to insert into a subtree.
-	 * x is the item to insert.
-	 * t is the node that roots the subtree.
-	 * Return a pointer to the node storing x.
+	 * Replace the tree with one written by save. Nodes and parent pointers
+	 * are rebuilt in one linear pass over the data.
+	 * Return false, leaving the tree unchanged, if the data is malformed.
 	 */
-	BinaryNode* insert(const Comparable & x, BinaryNode* t, BinaryNode* currentPoint)
+	bool load(istream & in)
 	{
+		string data{ istreambuf_iterator<char>{ in }, istreambuf_iterator<char>{ } };
+		return load(data.data(), data.size());
+	}
 
-		if (t == nullptr)
-		{
-			t = new BinaryNode{ x, nullptr, nullptr, currentPoint };
-		}
-		else if (x < t->element)
-		{
-			t->left = insert(x, t->left, t);
-		}
-		else if (t->element < x)
+	/**
+	 * Replace the tree with one written by save, from size bytes at data.
+	 * Return false, leaving the tree unchanged, if the data is malformed.
+	 * Each node is attached as it is read: to the left of the previous node
+	 * if that has a left child, else to its right if it has a right child,
+	 * else to the right of the latest node still waiting for its right child.
+	 */
+	bool load(const char *data, size_t size)
+	{
+		const char *p = data;
+		const char *end = data + size;
+		uint32_t keySize;
+		uint64_t count;
+
+		if (size < sizeof(saveMagic) + sizeof(keySize) + sizeof(count) ||
+			memcmp(p, saveMagic, sizeof(saveMagic)) != 0)
 		{
-			t->right = insert(x, t->right, t);
+			return false;
 		}
-		else
+		p += sizeof(saveMagic);
+		memcpy(&keySize, p, sizeof(keySize));
+		p += sizeof(keySize);
+		memcpy(&count, p, sizeof(count));
+		p += sizeof(count);
+
+		const size_t fixedSize = BinaryCodec<Comparable>::fixedSize;
+		const uint64_t shapeBytes = (count + 3) / 4;
+		if (keySize != fixedSize || static_cast<uint64_t>(end - p) < shapeBytes ||
+			(fixedSize != 0 && (static_cast<uint64_t>(end - p) - shapeBytes) / fixedSize != count))
 		{
-			;  // Duplicate; do nothing
+			return false;
 		}
 
-		return t;
-	}
+		const unsigned char *shape = reinterpret_cast<const unsigned char*>(p);
+		p += shapeBytes;
 
-	/**
-	 * Private member function to insert into a subtree.
-	 * x is the item to insert.
-	 * t is the node that roots the subtree.
-	 * Return a pointer to the node storing x.
-	 */
-	BinaryNode* insert(Comparable && x, BinaryNode* t)
-	{
-		if (t == nullptr)
+		BinaryNode *newRoot = nullptr;
+		BinaryNode *attachTo = nullptr;
+		bool asLeft = false;
+		vector<BinaryNode*> waitingRight;
+		vector<BinaryNode*> preorder;  // for the subtree sizes only
+
+		try
 		{
-			t = new BinaryNode{ std::move(x), nullptr, nullptr };
+			for (uint64_t i = 0; i < count; ++i)
+			{
+				Comparable x;
+				if (!BinaryCodec<Comparable>::read(p, end, x) || (i > 0 && attachTo == nullptr))
+				{
+					destroy(newRoot);
+					return false;
+				}
+
+				BinaryNode *t = new BinaryNode{ std::move(x), nullptr, nullptr, attachTo };
+				if (attachTo == nullptr)
+					newRoot = t;
+				else if (asLeft)
+					attachTo->left = t;
+				else
+					attachTo->right = t;
+				if (OrderStatistics) preorder.push_back(t);
+
+				unsigned bits = shape[i / 4] >> ((i % 4) * 2);
+				bool hasLeft = (bits & 1) != 0;
+				bool hasRight = (bits & 2) != 0;
+
+				if (hasLeft)
+				{
+					if (hasRight) waitingRight.push_back(t);
+					attachTo = t;
+					asLeft = true;
+				}
+				else if (hasRight)
+				{
+					attachTo = t;
+					asLeft = false;
+				}
+				else if (!waitingRight.empty())
+				{
+					attachTo = waitingRight.back();
+					waitingRight.pop_back();
+					asLeft = false;
+				}
+				else
+				{
+					attachTo = nullptr;
+				}
+			}
 		}
-		else if (x < t->element)
+		catch (...)
 		{
-			t->left = insert(std::move(x), t->left);
+			destroy(newRoot);
+			throw;
 		}
-		else if (t->element < x)
+
+		if (attachTo != nullptr || p != end)
 		{
-			t->right = insert(std::move(x), t->right);
+			destroy(newRoot);
+			return false;
 		}
-		else
+
+		// children follow their parent in pre-order
+		for (auto i = preorder.rbegin(); i != preorder.rend(); ++i)
 		{
-			;  // Duplicate; do nothing
+			update_size(*i);
 		}
 
-		return t;
+		makeEmpty();
+		root = newRoot;
+		link_subtree(root);
+		index.rebuild(root);
+		return true;
 	}
 
-
 	/**
-	 * Private member function to remove from a subtree.
-	 * x is the item to remove.
-	 * t is the node that roots the subtree.
-	 * Return a pointer to the new root of the subtree that had root x
+	 * Return the shape statistics of the tree: node count, height,
+	 * average and maximum depth, depth histogram and memory footprint.
+	 * Costs one traversal of the tree.
 	 */
-	BinaryNode* remove(const Comparable & x, BinaryNode *t)
+	TreeStats stats() const
 	{
-		if (t == nullptr)
-		{
-			return t;   // Item not found
-		}
-		if (x < t->element)
-		{
-			t->left = remove(x, t->left);
-		}
-		else if (t->element < x)
-		{
-			t->right = remove(x, t->right);
-		}
+		TreeStats s;
+		size_t depthSum = 0;
+		vector<pair<BinaryNode*, size_t>> pending;
+		if (root != nullptr) pending.push_back({ root, 0 });
 
-		else if (t->left != nullptr && t->right != nullptr) // Two children
-		{
-			t->element = findMin(t->right)->element;
-			t->right = remove(t->element, t->right);
-		}
-		else
+		while (!pending.empty())
 		{
-			BinaryNode *oldNode = t;
-			t = (t->left != nullptr) ? t->left : t->right;
-			//We changed here
-			if (t != nullptr) t->parent = oldNode->parent;
-			delete oldNode;
+			BinaryNode *t = pending.back().first;
+			size_t depth = pending.back().second;
+			pending.pop_back();
+
+			if (s.depthHistogram.size() <= depth) s.depthHistogram.resize(depth + 1);
+			++s.depthHistogram[depth];
+			++s.nodeCount;
+			depthSum += depth;
+
+			if (t->left != nullptr) pending.push_back({ t->left, depth + 1 });
+			if (t->right != nullptr) pending.push_back({ t->right, depth + 1 });
 		}
 
-		return t;
-	}
+		s.height = s.depthHistogram.size();
+		s.maxDepth = (s.height > 0) ? s.height - 1 : 0;
+		s.averageDepth = (s.nodeCount > 0) ? static_cast<double>(depthSum) / s.nodeCount : 0;
+		for (size_t n = s.nodeCount; n > 0; n /= 2) ++s.minimalHeight;
+		s.memoryBytes = sizeof(*this) + s.nodeCount * sizeof(BinaryNode) + index.memoryBytes();
 
+		return s;
+	}
 
 	/**
-	 * Private member function to find the smallest item in a subtree t.
-	 * Return node containing the smallest item.
+	 * Print the tree contents in sorted order.
 	 */
-	static BinaryNode * findMin(BinaryNode *t)
+	void printTree(ostream & out = cout) const
 	{
-		if (t == nullptr)
+		if (isEmpty())
 		{
-			return nullptr;
+			out << "Empty tree" << endl;
 		}
-		if (t->left == nullptr)
+		else
 		{
-			return t;
+			printTree(root, out, "");
 		}
-
-		//Tail recursion can be easily replaced by a loop
-		return findMin(t->left); //recursive call
 	}
 
 	/**
-	 * Private member function to find the largest item in a subtree t.
+	 * Make the tree logically empty.
+	 */
+	void makeEmpty()
+	{
+		root = makeEmpty(root);
+		index.clear();
+		maxNode = nullptr;
+	}
+
+	/**
+	 * Insert x into the tree; duplicates are ignored.
+	 */
+	void insert(const Comparable & x)
+	{
+		BST_MEASURE(insert);
+		adapt(insert_node(x));
+	}
+
+	/**
+	 * Insert x into the tree; duplicates are ignored.
+	 */
+	void insert(Comparable && x)
+	{
+		BST_MEASURE(insert);
+		adapt(insert_node(std::move(x)));
+	}
+
+	/**
+	 * Insert x into the tree, searching from hint; duplicates are ignored.
+	 * Return an iterator to the item equal to x in the tree.
+	 */
+	BiIterator insert(BiIterator hint, const Comparable & x)
+	{
+		BST_MEASURE(insert);
+		find_max_node();
+		BinaryNode *t = insert_node(x, hint.current);
+		adapt(t);
+		return BiIterator(t);
+	}
+
+	/**
+	 * Insert x into the tree, searching from hint; duplicates are ignored.
+	 * Return an iterator to the item equal to x in the tree.
+	 */
+	BiIterator insert(BiIterator hint, Comparable && x)
+	{
+		BST_MEASURE(insert);
+		find_max_node();
+		BinaryNode *t = insert_node(std::move(x), hint.current);
+		adapt(t);
+		return BiIterator(t);
+	}
+
+	/**
+	 * Finger search: return an iterator to x, or end( ) if x is not found,
+	 * searching from the item at from instead of from the root.
+	 */
+	BiIterator find(BiIterator from, const Comparable & x) const
+	{
+		BST_MEASURE(contains);
+		BinaryNode *parent;
+		BinaryNode *t = (from.current != nullptr) ? *finger_link(x, from.current, parent) : root;
+		t = contains(x, t);
+		adapt(t);
+		return BiIterator(t);
+	}
+
+	/**
+	 * Insert an item constructed in place from args; duplicates are ignored.
+	 * The item is built before the search, and destroyed if it is a duplicate.
+	 * Return an iterator to the item with the same key in the tree, and
+	 * true if the new item was inserted.
+	 */
+	template <typename... Args>
+	pair<BiIterator, bool> emplace(Args && ... args)
+	{
+		BST_MEASURE(insert);
+		BinaryNode *n = new BinaryNode{ piecewise_construct, nullptr, std::forward<Args>(args)... };
+		BinaryNode *parent;
+		BinaryNode **link = find_link(n->element, parent);
+
+		if (*link != nullptr) // Duplicate
+		{
+			delete n;
+			BinaryNode *t = *link;
+			adapt(t);
+			return { BiIterator(t), false };
+		}
+
+		n->parent = parent;
+		*link = n;
+		adjust_sizes(parent, 1);
+		index.insert(n);
+		note_insert(link, parent);
+		adapt(n);
+		return { BiIterator(n), true };
+	}
+
+	/**
+	 * Insert an item constructed in place from args, unless an item
+	 * equivalent to key is already in the tree; then nothing is constructed.
+	 * The constructed item must be equivalent to key.
+	 * Return an iterator to the item with key, and true if it was inserted.
+	 */
+	template <typename K, typename... Args>
+	pair<BiIterator, bool> try_emplace(const K & key, Args && ... args)
+	{
+		BST_MEASURE(insert);
+		BinaryNode *parent;
+		BinaryNode **link = find_link(key, parent);
+		bool inserted = false;
+
+		if (*link == nullptr)
+		{
+			*link = new BinaryNode{ piecewise_construct, parent, std::forward<Args>(args)... };
+			adjust_sizes(parent, 1);
+			index.insert(*link);
+			note_insert(link, parent);
+			inserted = true;
+		}
+
+		BinaryNode *t = *link;
+		adapt(t);
+		return { BiIterator(t), inserted };
+	}
+
+	/**
+	 * Remove x from the tree. Nothing is done if x is not found.
+	 */
+	void remove(const Comparable & x)
+	{
+		BST_MEASURE(remove);
+		BinaryNode *parent;
+		BinaryNode **link = find_link(x, parent);
+
+		if (*link != nullptr)
+		{
+			remove(link);
+		}
+	}
+
+	/**
+	 * Remove all items x with lo <= x <= hi.
+	 * Whole subtrees inside the range are unlinked at once, so the cost is
+	 * O(height + k) for k removed items.
+	 * Return the number of items removed.
+	 */
+	size_t erase_range(const Comparable & lo, const Comparable & hi)
+	{
+		if (comp(hi, lo)) return 0;
+
+		// Find the topmost node in [lo, hi]; all other items in the range are below it
+		BinaryNode **link = &root;
+		BinaryNode *parent = nullptr;
+
+		while (*link != nullptr)
+		{
+			if (comp((*link)->element, lo))
+			{
+				parent = *link;
+				link = &parent->right;
+			}
+			else if (comp(hi, (*link)->element))
+			{
+				parent = *link;
+				link = &parent->left;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		BinaryNode *top = *link;
+		if (top == nullptr) return 0;
+
+		// the neighbours of the range, to be linked to each other
+		BinaryNode *before = top->prev;
+		BinaryNode *after = top->next;
+		while (before != nullptr && !comp(before->element, lo)) before = before->prev;
+		while (after != nullptr && !comp(hi, after->element)) after = after->next;
+
+		size_t erased = 1;
+		BinaryNode *below = keep_less(top->left, lo, erased);
+		BinaryNode *above = keep_greater(top->right, hi, erased);
+		index.erase(top);
+		delete top;
+		maxNode = nullptr;
+
+		BinaryNode *t = join_trees(below, above);
+		*link = t;
+		if (t != nullptr) t->parent = parent;
+		update_sizes_up(parent);
+		link_pair(before, after);
+
+		return erased;
+	}
+
+	/**
+	 * Move the items not less than x into a new tree, which is returned.
+	 * The items less than x stay in this tree. Costs O(height).
+	 */
+	BinarySearchTree split(const Comparable & x)
+	{
+		BinarySearchTree upper;
+		BinaryNode *lo;
+		BinaryNode *hi;
+		BinaryNode *match = split_node(root, x, lo, hi);
+
+		root = lo;
+		upper.root = (match != nullptr) ? join_node(nullptr, match, hi) : hi;
+		upper.comp = comp;
+		upper.mode = mode;
+		unlink_ends(root);
+		unlink_ends(upper.root);
+		index.rebuild(root);
+		upper.index.rebuild(upper.root);
+		maxNode = nullptr;
+		return upper;
+	}
+
+	/**
+	 * Concatenate two trees where every item of left is less than every
+	 * item of right. Costs O(height).
+	 * Throw IllegalArgumentException if the trees overlap.
+	 */
+	static BinarySearchTree join(BinarySearchTree left, BinarySearchTree right)
+	{
+		if (!left.isEmpty() && !right.isEmpty() &&
+			!left.comp(findMax(left.root)->element, findMin(right.root)->element))
+		{
+			throw IllegalArgumentException{ };
+		}
+
+		link_pair(findMax(left.root), findMin(right.root));
+		left.root = join_trees(left.root, right.root);
+		right.root = nullptr;
+		right.index.clear();
+		right.maxNode = nullptr;
+		left.index.rebuild(left.root);
+		left.maxNode = nullptr;
+		return left;
+	}
+
+	/**
+	 * Add the items of other to this tree.
+	 */
+	void union_with(BinarySearchTree other)
+	{
+		root = set_nodes(SetOp::Union, root, other.root, 0);
+		unlink_ends(root);
+		other.root = nullptr;
+		other.index.clear();
+		other.maxNode = nullptr;
+		index.rebuild(root);
+		maxNode = nullptr;
+	}
+
+	/**
+	 * Keep only the items that are also in other.
+	 */
+	void intersect_with(BinarySearchTree other)
+	{
+		root = set_nodes(SetOp::Intersect, root, other.root, 0);
+		unlink_ends(root);
+		other.root = nullptr;
+		other.index.clear();
+		other.maxNode = nullptr;
+		index.rebuild(root);
+		maxNode = nullptr;
+	}
+
+	/**
+	 * Remove the items that are in other.
+	 */
+	void difference_with(BinarySearchTree other)
+	{
+		root = set_nodes(SetOp::Difference, root, other.root, 0);
+		unlink_ends(root);
+		other.root = nullptr;
+		other.index.clear();
+		other.maxNode = nullptr;
+		index.rebuild(root);
+		maxNode = nullptr;
+	}
+
+	/**
+	 * Heterogeneous version of remove, for transparent comparators only.
+	 */
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	void remove(const K & x)
+	{
+		BST_MEASURE(remove);
+		BinaryNode *parent;
+		BinaryNode **link = find_link(x, parent);
+
+		if (*link != nullptr)
+		{
+			remove(link);
+		}
+	}
+
+private:
+	static constexpr char saveMagic[4] = { 'B', 'S', 'T', '1' };
+
+	mutable BinaryNode *root;  // mutable: lookups restructure the tree in the splay modes
+	Compare comp;
+	AccessMode mode = AccessMode::Static;
+	NodeHashIndex<BinaryNode, Hash> index;
+	BinaryNode *maxNode = nullptr;  // node of the largest item, or nullptr if not known
+
+
+
+#ifdef BST_INSTRUMENTATION
+	// Adds the comparisons made during its lifetime to an operation's total
+	struct CountComparisons
+	{
+		size_t & total;
+		size_t start;
+
+		CountComparisons(size_t & calls, size_t & theTotal)
+			: total{ theTotal }, start{ bst_counters().comparisons }
+		{
+			++calls;
+		}
+
+		~CountComparisons()
+		{
+			total += bst_counters().comparisons - start;
+		}
+	};
+#endif
+
+	/**
+	 * Private member function to compare a and b, counting the comparison
+	 * if BST_INSTRUMENTATION is defined.
+	 */
+	template <typename A, typename B>
+	bool less(const A & a, const B & b) const
+	{
+		BST_COUNT(comparisons, 1);
+		return comp(a, b);
+	}
+
+	/**
+	 * Private member function to find where x is, or would be, stored.
+	 * Walks down from the root without recursion.
+	 * Return the link (root or a child pointer) that points to the node
+	 * storing x, or the null link where x would be inserted.
+	 * parent is set to the node owning that link (nullptr for the root).
+	 * If from is not nullptr, the search starts at the link found by
+	 * finger_link instead of at the root.
+	 */
+	template <typename K>
+	BinaryNode** find_link(const K & x, BinaryNode* & parent, BinaryNode *from = nullptr)
+	{
+		BinaryNode **link = &root;
+		parent = nullptr;
+
+		if (from != nullptr)
+		{
+			link = finger_link(x, from, parent);
+		}
+
+		while (*link != nullptr)
+		{
+			if (less(x, (*link)->element))
+			{
+				parent = *link;
+				link = &parent->left;
+			}
+			else if (less((*link)->element, x))
+			{
+				parent = *link;
+				link = &parent->right;
+			}
+			else
+			{
+				break;  // Match
+			}
+		}
+
+		return link;
+	}
+
+	/**
+	 * Private member function to find, starting at node f, the link below
+	 * which x is or would be stored. The level links are followed from f
+	 * toward x until x is found or lies between two neighbours n < x < m;
+	 * x then belongs below n if n has no right child, else below m, which
+	 * is the leftmost node of that child's subtree. A search from the root
+	 * takes one step after every step along the links, and returns instead
+	 * if it finishes first, so the cost is O(min(d, height)) for d items
+	 * between f and x. An x greater than maxNode is linked below it at once.
+	 * parent is set to the node owning the link (nullptr for the root).
+	 */
+	template <typename K>
+	BinaryNode** finger_link(const K & x, BinaryNode *f, BinaryNode* & parent) const
+	{
+		if (maxNode != nullptr && less(maxNode->element, x)) // appending
+		{
+			parent = maxNode;
+			return &maxNode->right;
+		}
+
+		bool up = less(f->element, x);
+
+		if (!up && !less(x, f->element))
+		{
+			return link_to(f, parent);  // Match
+		}
+
+		BinaryNode **link = &root;   // the search from the root
+		BinaryNode *down = nullptr;  // owner of link
+		BinaryNode *n = f;           // x lies beyond n in the direction of up
+
+		while (true)
+		{
+			BinaryNode *m = up ? n->next : n->prev;
+
+			if (m == nullptr || (up ? less(x, m->element) : less(m->element, x)))
+			{
+				BinaryNode *lo = up ? n : m;   // x lies between lo and hi
+				BinaryNode *hi = up ? m : n;
+
+				if (lo != nullptr && lo->right == nullptr)
+				{
+					parent = lo;
+					return &lo->right;
+				}
+
+				parent = hi;
+				return &hi->left;
+			}
+
+			if (!(up ? less(m->element, x) : less(x, m->element)))
+			{
+				return link_to(m, parent);  // Match
+			}
+
+			n = m;
+
+			if (*link == nullptr)
+			{
+				parent = down;
+				return link;
+			}
+
+			if (less(x, (*link)->element))
+			{
+				down = *link;
+				link = &down->left;
+			}
+			else if (less((*link)->element, x))
+			{
+				down = *link;
+				link = &down->right;
+			}
+			else
+			{
+				parent = down;
+				return link;  // Match
+			}
+		}
+	}
+
+	/**
+	 * Private member function to set maxNode if it is not known, which
+	 * costs one walk down the right spine after operations that reshaped
+	 * the tree. Single inserts and removes keep maxNode up to date.
+	 */
+	void find_max_node()
+	{
+		if (maxNode == nullptr && root != nullptr)
+		{
+			maxNode = findMax(root);
+		}
+	}
+
+	/**
+	 * Private member function to set the level links of a new leaf, linked
+	 * in at link, a child pointer of parent, and to update maxNode.
+	 */
+	void note_insert(BinaryNode **link, BinaryNode *parent)
+	{
+		BinaryNode *t = *link;
+
+		if (parent == nullptr)
+		{
+			t->prev = t->next = nullptr;
+		}
+		else if (link == &parent->right)
+		{
+			link_pair(t, parent->next);
+			link_pair(parent, t);
+		}
+		else
+		{
+			link_pair(parent->prev, t);
+			link_pair(t, parent);
+		}
+
+		if (parent != nullptr && parent == maxNode && link == &parent->right)
+		{
+			maxNode = t;
+		}
+	}
+
+	/**
+	 * Private member function to make a and b neighbours in the level links;
+	 * either may be nullptr.
+	 */
+	static void link_pair(BinaryNode *a, BinaryNode *b)
+	{
+		if (a != nullptr) a->next = b;
+		if (b != nullptr) b->prev = a;
+	}
+
+	/**
+	 * Private member function to set the level links of all nodes in the
+	 * subtree t, in one in-order walk with an explicit stack.
+	 */
+	static void link_subtree(BinaryNode *t)
+	{
+		vector<BinaryNode*> pending;
+		BinaryNode *last = nullptr;
+
+		while (t != nullptr || !pending.empty())
+		{
+			for (; t != nullptr; t = t->left)
+			{
+				pending.push_back(t);
+			}
+
+			t = pending.back();
+			pending.pop_back();
+			link_pair(last, t);
+			last = t;
+			t = t->right;
+		}
+
+		link_pair(last, nullptr);
+	}
+
+	/**
+	 * Private member function to clear the level links that lead out of the
+	 * subtree t, from its smallest and its largest node.
+	 */
+	static void unlink_ends(BinaryNode *t)
+	{
+		if (t != nullptr)
+		{
+			findMin(t)->prev = nullptr;
+			findMax(t)->next = nullptr;
+		}
+	}
+
+	/**
+	 * Private member function to return the link (root or a child pointer)
+	 * that points to t, and set parent to the parent of t.
+	 */
+	BinaryNode** link_to(BinaryNode *t, BinaryNode* & parent) const
+	{
+		parent = t->parent;
+		if (parent == nullptr) return &root;
+		return (t == parent->left) ? &parent->left : &parent->right;
+	}
+
+	/**
+	 * Private member function to insert into the tree.
+	 * x is the item to insert.
+	 * Return a pointer to the node storing x.
+	 */
+	BinaryNode* insert_node(const Comparable & x, BinaryNode *from = nullptr)
+	{
+		BinaryNode *parent;
+		BinaryNode **link = find_link(x, parent, from);
+
+		if (*link == nullptr)
+		{
+			*link = new BinaryNode{ x, nullptr, nullptr, parent };
+			adjust_sizes(parent, 1);
+			index.insert(*link);
+			note_insert(link, parent);
+		}
+		//else Duplicate; do nothing
+
+		return *link;
+	}
+
+	/**
+	 * Private member function to insert into the tree.
+	 * x is the item to insert.
+	 * Return a pointer to the node storing x.
+	 */
+	BinaryNode* insert_node(Comparable && x, BinaryNode *from = nullptr)
+	{
+		BinaryNode *parent;
+		BinaryNode **link = find_link(x, parent, from);
+
+		if (*link == nullptr)
+		{
+			*link = new BinaryNode{ std::move(x), nullptr, nullptr, parent };
+			adjust_sizes(parent, 1);
+			index.insert(*link);
+			note_insert(link, parent);
+		}
+		//else Duplicate; do nothing
+
+		return *link;
+	}
+
+
+	/**
+	 * Private member function to remove a node from the tree.
+	 * link is the root pointer or the child pointer that points to the node.
+	 * A node with two children is replaced by its successor node, which is
+	 * relinked into its place; no element is copied or moved.
+	 */
+	void remove(BinaryNode **link)
+	{
+		BinaryNode *t = *link;
+		index.erase(t);
+
+		if (t == maxNode)
+		{
+			maxNode = t->prev;
+		}
+		link_pair(t->prev, t->next);
+
+		if (t->left != nullptr && t->right != nullptr) // Two children
+		{
+			BinaryNode *succ = findMin(t->right);
+			BinaryNode *changed = succ;   // lowest node whose subtree changed
+
+			if (succ->parent != t)
+			{
+				changed = succ->parent;
+				changed->left = succ->right;
+				if (succ->right != nullptr) succ->right->parent = changed;
+				succ->right = t->right;
+				succ->right->parent = succ;
+			}
+
+			succ->left = t->left;
+			succ->left->parent = succ;
+			succ->parent = t->parent;
+			*link = succ;
+			update_sizes_up(changed);
+		}
+		else
+		{
+			BinaryNode *child = (t->left != nullptr) ? t->left : t->right;
+			*link = child;
+			if (child != nullptr) child->parent = t->parent;
+			adjust_sizes(t->parent, -1);
+		}
+
+		delete t;
+	}
+
+	/**
+	 * Private member function to count the items less than x,
+	 * or not greater than x if inclusive is true.
+	 */
+	size_t count_less(const Comparable & x, bool inclusive) const
+	{
+		size_t count = 0;
+		BinaryNode *t = root;
+
+		while (t != nullptr)
+		{
+			if (comp(t->element, x) || (inclusive && !comp(x, t->element)))
+			{
+				count += size_of(t->left) + 1;
+				t = t->right;
+			}
+			else
+			{
+				t = t->left;
+			}
+		}
+
+		return count;
+	}
+
+	/**
+	 * Subtree size helpers; they do nothing unless OrderStatistics is true.
+	 */
+	static size_t size_of(BinaryNode *t)
+	{
+		return size_of(t, integral_constant<bool, OrderStatistics>{});
+	}
+
+	static size_t size_of(BinaryNode *t, true_type)
+	{
+		return (t != nullptr) ? t->size : 0;
+	}
+
+	static size_t size_of(BinaryNode *, false_type)
+	{
+		return 0;
+	}
+
+	/**
+	 * Recompute the subtree size of t from its children.
+	 */
+	static void update_size(BinaryNode *t)
+	{
+		update_size(t, integral_constant<bool, OrderStatistics>{});
+	}
+
+	static void update_size(BinaryNode *t, true_type)
+	{
+		t->size = 1 + size_of(t->left) + size_of(t->right);
+	}
+
+	static void update_size(BinaryNode *, false_type)
+	{
+	}
+
+	/**
+	 * Recompute the subtree sizes of t and all its ancestors.
+	 */
+	static void update_sizes_up(BinaryNode *t)
+	{
+		if (!OrderStatistics) return;
+
+		for (; t != nullptr; t = t->parent)
+		{
+			update_size(t);
+		}
+	}
+
+	/**
+	 * Add delta to the subtree size of t and all its ancestors.
+	 */
+	static void adjust_sizes(BinaryNode *t, int delta)
+	{
+		adjust_sizes(t, delta, integral_constant<bool, OrderStatistics>{});
+	}
+
+	static void adjust_sizes(BinaryNode *t, int delta, true_type)
+	{
+		for (; t != nullptr; t = t->parent)
+		{
+			t->size += delta;
+		}
+	}
+
+	static void adjust_sizes(BinaryNode *, int, false_type)
+	{
+	}
+
+
+	/**
+	 * Private member function to find the smallest item in a subtree t.
+	 * Return node containing the smallest item.
+	 */
+	static BinaryNode * findMin(BinaryNode *t)
+	{
+		if (t != nullptr)
+		{
+			while (t->left != nullptr)
+			{
+				t = t->left;
+			}
+		}
+
+		return t;
+	}
+
+	/**
+	 * Private member function to find the largest item in a subtree t.
 	 * Return node containing the largest item.
 	 */
-	static BinaryNode * findMax(BinaryNode *t)
+	static BinaryNode * findMax(BinaryNode *t)
+	{
+		if (t != nullptr)
+		{
+			while (t->right != nullptr)
+			{
+				t = t->right;
+			}
+		}
+
+		return t;
+	}
+
+
+	/**
+	 * Private member function to test if an item is in a subtree.
+	 * x is item to search for.
+	 * t is the node that roots the subtree.
+	 * Return a pointer to the node storing x, if x is found
+	 * Otherwise, return nullptr
+	 */
+	template <typename K>
+	BinaryNode* contains(const K & x, BinaryNode *t) const
+	{
+		while (t != nullptr)
+		{
+			if (less(x, t->element))
+			{
+				t = t->left;
+			}
+			else if (less(t->element, x))
+			{
+				t = t->right;
+			}
+			else
+			{
+				return t;    // Match
+			}
+		}
+
+		return t;   // No match
+	}
+
+	/**
+	 * Private member function to look up x for contains.
+	 * In the splay modes, the node storing x, or the last node visited
+	 * if x is not found, is moved toward the root.
+	 * Return a pointer to the node storing x, or nullptr if not found.
+	 */
+	template <typename K>
+	BinaryNode* access(const K & x) const
+	{
+		if (mode == AccessMode::Static)
+		{
+			return contains(x, root);
+		}
+
+		BinaryNode *last = nullptr;
+		BinaryNode *t = root;
+
+		while (t != nullptr)
+		{
+			last = t;
+			if (less(x, t->element))
+			{
+				t = t->left;
+			}
+			else if (less(t->element, x))
+			{
+				t = t->right;
+			}
+			else
+			{
+				break;    // Match
+			}
+		}
+
+		adapt(last);
+		return t;
+	}
+
+	/**
+	 * Private member function for the batch lookups. Up to BatchWidth keys
+	 * are searched at a time; every round moves each unfinished search one
+	 * level down and prefetches the node it will compare with next round.
+	 * The node found is the match, or with lower set, the lower bound.
+	 */
+	template <typename ForwardIterator, typename OutputIterator>
+	OutputIterator search_batch(ForwardIterator first, ForwardIterator last, OutputIterator result, bool lower) const
+	{
+		ForwardIterator key[BatchWidth];
+		BinaryNode *at[BatchWidth];
+		BinaryNode *found[BatchWidth];
+
+		while (first != last)
+		{
+			size_t n = 0;
+			for (; n < BatchWidth && first != last; ++n, ++first)
+			{
+				key[n] = first;
+				at[n] = root;
+				found[n] = nullptr;
+			}
+
+			for (size_t active = n; active > 0; )
+			{
+				active = 0;
+
+				for (size_t i = 0; i < n; ++i)
+				{
+					BinaryNode *t = at[i];
+					if (t == nullptr) continue;
+
+					if (comp(*key[i], t->element))
+					{
+						if (lower) found[i] = t;
+						t = t->left;
+					}
+					else if (comp(t->element, *key[i]))
+					{
+						t = t->right;
+					}
+					else
+					{
+						found[i] = t;    // Match
+						t = nullptr;
+					}
+
+					at[i] = t;
+					if (t != nullptr)
+					{
+						BST_PREFETCH(t);
+						++active;
+					}
+				}
+			}
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				*result++ = BiIterator(found[i]);
+			}
+		}
+
+		return result;
+	}
+
+	/**
+	 * Private member function to find the node storing x, through the
+	 * hash index when it can answer and by access otherwise.
+	 * Return nullptr if x is not found.
+	 */
+	template <typename K>
+	BinaryNode* find_node(const K & x) const
+	{
+		BinaryNode *t;
+
+		if (!index.find(x, comp, t))
+		{
+			return access(x);
+		}
+
+		adapt(t);
+		return t;
+	}
+
+	/**
+	 * Private member function to restructure the tree after node x
+	 * was accessed, according to the access mode.
+	 */
+	void adapt(BinaryNode *x) const
+	{
+		if (x == nullptr || mode == AccessMode::Static)
+		{
+			return;
+		}
+
+		while (x->parent != nullptr)
+		{
+			BinaryNode *p = x->parent;
+			BinaryNode *g = p->parent;
+
+			if (g == nullptr) // zig
+			{
+				if (mode == AccessMode::SemiSplay) break;
+				rotate_up(x);
+			}
+			else if ((x == p->left) == (p == g->left)) // zig-zig
+			{
+				rotate_up(p);
+				if (mode == AccessMode::SemiSplay)
+					x = p;   // continue from p, leaving x below it
+				else
+					rotate_up(x);
+			}
+			else // zig-zag
+			{
+				rotate_up(x);
+				rotate_up(x);
+			}
+		}
+	}
+
+	/**
+	 * Private member function to rotate x above its parent,
+	 * keeping parent pointers and subtree sizes up to date.
+	 */
+	void rotate_up(BinaryNode *x) const
 	{
-		if (t != nullptr)
+		BinaryNode *p = x->parent;
+		BinaryNode *g = p->parent;
+
+		if (x == p->left)
 		{
-			while (t->right != nullptr)
+			p->left = x->right;
+			if (x->right != nullptr) x->right->parent = p;
+			x->right = p;
+		}
+		else
+		{
+			p->right = x->left;
+			if (x->left != nullptr) x->left->parent = p;
+			x->left = p;
+		}
+
+		p->parent = x;
+		x->parent = g;
+
+		if (g == nullptr)
+			root = x;
+		else if (g->left == p)
+			g->left = x;
+		else
+			g->right = x;
+
+		update_size(p);
+		update_size(x);
+	}
+
+	/**
+	 * Private member function to find the first item not less than x
+	 * in the subtree rooted at t.
+	 * Return a pointer to the node storing it, or nullptr if there is none.
+	 */
+	template <typename K>
+	BinaryNode* lower_bound(const K & x, BinaryNode *t) const
+	{
+		BinaryNode *result = nullptr;
+
+		while (t != nullptr)
+		{
+			if (comp(t->element, x))
 			{
 				t = t->right;
 			}
+			else
+			{
+				result = t;
+				t = t->left;
+			}
 		}
 
-		return t;
+		return result;
+	}
+
+	/**
+	 * Climb until t is a left child and return its parent.
+	 * Return nullptr if there is no such ancestor.
+	 */
+	static BinaryNode* climb_tree_succ(BinaryNode* t)
+	{
+		while (t->parent != nullptr && t == t->parent->right)
+		{
+			BST_COUNT(iteratorHops, 1);
+			t = t->parent;
+		}
+
+		BST_COUNT(iteratorHops, 1);
+		return t->parent;
 	}
 
+	/**
+	 * Climb until t is a right child and return its parent.
+	 * Return nullptr if there is no such ancestor.
+	 */
+	static BinaryNode* climb_tree_pred(BinaryNode* t)
+	{
+		while (t->parent != nullptr && t == t->parent->left)
+		{
+			BST_COUNT(iteratorHops, 1);
+			t = t->parent;
+		}
+
+		BST_COUNT(iteratorHops, 1);
+		return t->parent;
+	}
 
 	/**
-	 * Private member function to test if an item is in a subtree.
-	 * x is item to search for.
-	 * t is the node that roots the subtree.
-	 * Return a pointer to the node storing x, if x is found
-	 * Otherwise, return nullptr
+	 * Return the in-order successor of t, or nullptr if t is the largest item.
+	 * Only the path between t and its successor is visited, so a full
+	 * in-order walk costs O(n) in total.
 	 */
-	BinaryNode* contains(const Comparable & x, BinaryNode *t) const
+	static BinaryNode* find_successor(BinaryNode* t)
 	{
-		if (t == nullptr)
+		if (t == nullptr) return nullptr;
+
+		if (t->right != nullptr) //t has a right sub-tree
 		{
-			return t;
+			BinaryNode *s = findMin(t->right);
+			BST_COUNT(iteratorHops, depth_below(t, s));
+			return s;
 		}
-		else if (x < t->element)
+		else //successor is one of the ancestors
 		{
-			return contains(x, t->left);
+			return climb_tree_succ(t);
 		}
-		else if (t->element < x)
+	}
+
+	/**
+	 * Return the in-order predecessor of t, or nullptr if t is the smallest item.
+	 */
+	static BinaryNode* find_predecessor(BinaryNode* t)
+	{
+		if (t == nullptr) return nullptr;
+
+		if (t->left != nullptr) //t has a left sub-tree
 		{
-			return contains(x, t->right);
+			BinaryNode *p = findMax(t->left);
+			BST_COUNT(iteratorHops, depth_below(t, p));
+			return p;
 		}
-		else
+		else //predecessor is one of the ancestors
 		{
-			return t;    // Match
+			return climb_tree_pred(t);
 		}
 	}
 
-	static BinaryNode* climb_tree_succ(BinaryNode* t)
+#ifdef BST_INSTRUMENTATION
+	/**
+	 * Return the number of edges from ancestor a down to t.
+	 */
+	static size_t depth_below(BinaryNode *a, BinaryNode *t)
 	{
-		if (t->parent == nullptr) return t;
-		if (t == t->parent->left) return t->parent;
-		climb_tree_succ(t->parent);
+		size_t d = 0;
+		for (; t != a; t = t->parent) ++d;
+		return d;
 	}
+#endif
 
-	static BinaryNode* climb_tree_pred(BinaryNode* t)
+	/**
+	 * Private member function to cut all items not less than lo out of
+	 * the subtree t. Only the path along lo is walked; subtrees that lie
+	 * entirely in the range are deleted whole. erased is increased by the
+	 * number of deleted items.
+	 * Return the root of what is left, with parent set to nullptr.
+	 */
+	BinaryNode* keep_less(BinaryNode *t, const Comparable & lo, size_t & erased)
 	{
-		if (t->parent == nullptr) return t;
-		if (t == t->parent->right) return t->parent;
-		climb_tree_pred(t->parent);
+		BinaryNode *result = nullptr;
+		BinaryNode **link = &result;
+		BinaryNode *parent = nullptr;
+
+		while (t != nullptr)
+		{
+			if (comp(t->element, lo)) // keep t and its left subtree
+			{
+				*link = t;
+				t->parent = parent;
+				parent = t;
+				link = &t->right;
+				t = t->right;
+			}
+			else // t and its right subtree are in the range
+			{
+				BinaryNode *next = t->left;
+				index.erase_subtree(t->right);
+				index.erase(t);
+				erased += 1 + destroy(t->right);
+				delete t;
+				t = next;
+			}
+		}
+
+		*link = nullptr;
+		update_sizes_up(parent);
+		return result;
 	}
 
-	static BinaryNode* climb_tree_top(BinaryNode* t)
+	/**
+	 * Private member function to cut all items not greater than hi out of
+	 * the subtree t; the mirror image of keep_less.
+	 */
+	BinaryNode* keep_greater(BinaryNode *t, const Comparable & hi, size_t & erased)
 	{
-		if (t->parent == nullptr) return t;
-		climb_tree_top(t->parent);
+		BinaryNode *result = nullptr;
+		BinaryNode **link = &result;
+		BinaryNode *parent = nullptr;
+
+		while (t != nullptr)
+		{
+			if (comp(hi, t->element)) // keep t and its right subtree
+			{
+				*link = t;
+				t->parent = parent;
+				parent = t;
+				link = &t->left;
+				t = t->left;
+			}
+			else // t and its left subtree are in the range
+			{
+				BinaryNode *next = t->right;
+				index.erase_subtree(t->left);
+				index.erase(t);
+				erased += 1 + destroy(t->left);
+				delete t;
+				t = next;
+			}
+		}
+
+		*link = nullptr;
+		update_sizes_up(parent);
+		return result;
 	}
 
-	static BinaryNode* find_successor(BinaryNode* t)
+	/**
+	 * Private member function to join two subtrees where every item in a
+	 * is less than every item in b. Both roots must have a null parent.
+	 * The smallest node of b becomes the new root, so the height grows by
+	 * at most one.
+	 * Return the root of the joined tree, with parent set to nullptr.
+	 */
+	static BinaryNode* join_trees(BinaryNode *a, BinaryNode *b)
 	{
-		BinaryNode* root = nullptr;
-		if (t != nullptr) root = climb_tree_top(t);
+		if (a == nullptr) return b;
+		if (b == nullptr) return a;
+
+		BinaryNode *m = findMin(b);
+
+		if (m != b)
+		{
+			BinaryNode *p = m->parent;
+			p->left = m->right;
+			if (m->right != nullptr) m->right->parent = p;
+			update_sizes_up(p);
 
-		if (findMax(root) == t) return t; //t is largest value in the tree
+			m->right = b;
+			b->parent = m;
+		}
+
+		m->left = a;
+		a->parent = m;
+		m->parent = nullptr;
+		update_size(m);
+
+		return m;
+	}
 
-		if (findMax(root)->element < t->element) return nullptr; //t is largest value in the tree
+	/**
+	 * Private member function to split subtree t around x: items less than
+	 * x go to lo, items greater than x to hi. Only the search path of x is
+	 * walked. The roots of lo and hi get a null parent.
+	 * Return the detached node storing x, or nullptr if x is not present.
+	 */
+	BinaryNode* split_node(BinaryNode *t, const Comparable & x, BinaryNode* & lo, BinaryNode* & hi) const
+	{
+		BinaryNode **loLink = &lo;
+		BinaryNode **hiLink = &hi;
+		BinaryNode *loParent = nullptr;
+		BinaryNode *hiParent = nullptr;
+		BinaryNode *match = nullptr;
 
-		if (t != nullptr && t->right != nullptr) //t has a right sub-tree
+		while (t != nullptr)
 		{
-			return findMin(t->right);
+			if (comp(t->element, x)) // t and its left subtree go to lo
+			{
+				*loLink = t;
+				t->parent = loParent;
+				loParent = t;
+				loLink = &t->right;
+				t = t->right;
+			}
+			else if (comp(x, t->element)) // t and its right subtree go to hi
+			{
+				*hiLink = t;
+				t->parent = hiParent;
+				hiParent = t;
+				hiLink = &t->left;
+				t = t->left;
+			}
+			else
+			{
+				match = t;
+				break;
+			}
 		}
-		else //successor is one of the ancestors
+
+		*loLink = (match != nullptr) ? match->left : nullptr;
+		*hiLink = (match != nullptr) ? match->right : nullptr;
+		if (*loLink != nullptr) (*loLink)->parent = loParent;
+		if (*hiLink != nullptr) (*hiLink)->parent = hiParent;
+
+		if (match != nullptr)
 		{
-			return climb_tree_succ(t);
+			match->left = match->right = match->parent = nullptr;
+			update_size(match);
 		}
+		update_sizes_up(loParent);
+		update_sizes_up(hiParent);
+
+		return match;
 	}
 
-	static BinaryNode* find_predecessor(BinaryNode* t)
+	/**
+	 * Private member function to make m the root over subtrees lo and hi,
+	 * where lo < m < hi. Return m, with a null parent.
+	 */
+	static BinaryNode* join_node(BinaryNode *lo, BinaryNode *m, BinaryNode *hi)
+	{
+		m->left = lo;
+		m->right = hi;
+		m->parent = nullptr;
+		if (lo != nullptr) lo->parent = m;
+		if (hi != nullptr) hi->parent = m;
+		update_size(m);
+		return m;
+	}
+
+	/**
+	 * Private member function to detach the children of t.
+	 */
+	static void detach_children(BinaryNode *t, BinaryNode* & lt, BinaryNode* & rt)
 	{
-		BinaryNode* root = nullptr;
-		if (t != nullptr) root = climb_tree_top(t);
+		lt = t->left;
+		rt = t->right;
+		if (lt != nullptr) lt->parent = nullptr;
+		if (rt != nullptr) rt->parent = nullptr;
+		t->left = t->right = nullptr;
+	}
+
+	/**
+	 * Private member function to return the depth of the set operation
+	 * recursion down to which tasks are forked, which gives about one task
+	 * per thread of the shared TaskPool.
+	 */
+	static int fork_depth()
+	{
+		static const int maxDepth = static_cast<int>(std::ceil(std::log2(TaskPool::shared().threads())));
+		return maxDepth;
+	}
 
-		if (findMin(root) == t) return t; //t is largest value in the tree
+	/**
+	 * Private member function to run f and g and store their results in lo
+	 * and hi. f is forked to the shared TaskPool, so the two halves of a set
+	 * operation are processed in parallel when a worker is free.
+	 */
+	template <typename F, typename G>
+	static void fork_join(F f, G g, BinaryNode* & lo, BinaryNode* & hi)
+	{
+		TaskPool::shared().fork_join([&]() { lo = f(); }, [&]() { hi = g(); });
+	}
 
-		if (findMin(root)->element > t->element) return nullptr; //t is largest value in the tree
+	enum class SetOp { Union, Intersect, Difference };
 
-		if (t != nullptr && t->left != nullptr) //t has a right sub-tree
+	/**
+	 * Private member function for one step of set operation op on subtrees
+	 * a and b, both with a null parent.
+	 * Union: b is split around the root of a; duplicate nodes of b are
+	 * deleted.
+	 * Intersection: b is split around the root of a; nodes of a not in b,
+	 * and all nodes of b, are deleted.
+	 * Difference: a is split around the root of b; nodes of a that are in
+	 * b, and all nodes of b, are deleted.
+	 * Return true, with the root of the result in result, if the result is
+	 * known at once. Otherwise return false: the result is then op on
+	 * (al, bl) and op on (ar, br), combined by combine_step with keep.
+	 */
+	bool split_step(SetOp op, BinaryNode *a, BinaryNode *b, BinaryNode* & result,
+		BinaryNode* & al, BinaryNode* & bl, BinaryNode* & ar, BinaryNode* & br, BinaryNode* & keep) const
+	{
+		switch (op)
 		{
-			return findMax(t->left);
+		case SetOp::Union:
+			if (a == nullptr || b == nullptr)
+			{
+				result = (a != nullptr) ? a : b;
+				return true;
+			}
+			delete split_node(b, a->element, bl, br);
+			detach_children(a, al, ar);
+			keep = a;
+			return false;
+
+		case SetOp::Intersect:
+			if (a == nullptr || b == nullptr)
+			{
+				destroy(a);
+				destroy(b);
+				result = nullptr;
+				return true;
+			}
+			keep = split_node(b, a->element, bl, br);
+			detach_children(a, al, ar);
+			if (keep != nullptr)
+			{
+				delete keep;
+				keep = a;
+			}
+			else
+			{
+				delete a;
+			}
+			return false;
+
+		default:
+			if (a == nullptr || b == nullptr)
+			{
+				destroy(b);
+				result = a;
+				return true;
+			}
+			delete split_node(a, b->element, al, ar);
+			detach_children(b, bl, br);
+			delete b;
+			keep = nullptr;
+			return false;
 		}
-		else //successor is one of the ancestors
+	}
+
+	/**
+	 * Private member function to combine the results lo and hi of a set
+	 * operation step, over keep if that is not nullptr. The level links
+	 * across the seams are set; those leading out of the result are left
+	 * for unlink_ends.
+	 */
+	static BinaryNode* combine_step(BinaryNode *lo, BinaryNode *keep, BinaryNode *hi)
+	{
+		BinaryNode *loMax = findMax(lo);
+		BinaryNode *hiMin = findMin(hi);
+
+		if (keep != nullptr)
 		{
-			return climb_tree_pred(t);
+			link_pair(loMax, keep);
+			link_pair(keep, hiMin);
+			return join_node(lo, keep, hi);
 		}
+
+		link_pair(loMax, hiMin);
+		return join_trees(lo, hi);
 	}
 
-	/****** NONRECURSIVE VERSION*************************
-		Node* contains( const Comparable & x, BinaryNode *t ) const
+	/**
+	 * Private member function for set operation op on subtrees a and b, both
+	 * with a null parent. The two halves of the top few steps are processed
+	 * in parallel by fork_join; below that, the steps are driven by an
+	 * explicit stack, so degenerate trees cannot overflow the call stack.
+	 * Return the root of the result, with a null parent.
+	 */
+	BinaryNode* set_nodes(SetOp op, BinaryNode *a, BinaryNode *b, int depth)
+	{
+		BinaryNode *result, *al, *bl, *ar, *br, *keep;
+
+		if (depth < fork_depth())
+		{
+			if (split_step(op, a, b, result, al, bl, ar, br, keep)) return result;
+
+			BinaryNode *lo, *hi;
+			fork_join(
+				[=]() { return set_nodes(op, al, bl, depth + 1); },
+				[=]() { return set_nodes(op, ar, br, depth + 1); }, lo, hi);
+
+			return combine_step(lo, keep, hi);
+		}
+
+		// A task is split once; its two halves are pushed above it and
+		// store their results in it before it is combined and popped
+		struct Task
 		{
-			while( t != nullptr )
+			BinaryNode *a, *b, *keep, *lo, *hi;
+			size_t parent;
+			bool right;
+			bool split;
+		};
+		const size_t none = static_cast<size_t>(-1);
+
+		vector<Task> tasks;
+		tasks.push_back(Task{ a, b, nullptr, nullptr, nullptr, none, false, false });
+		result = nullptr;
+
+		while (!tasks.empty())
+		{
+			size_t i = tasks.size() - 1;
+			BinaryNode *r;
+
+			if (!tasks[i].split)
 			{
-				if( x < t->element )
-				{
-					t = t->left;
-				}
-				else if( t->element < x )
+				if (!split_step(op, tasks[i].a, tasks[i].b, r, al, bl, ar, br, tasks[i].keep))
 				{
-					t = t->right;
-				}
-				else
-				{
-					return t;    // Match
+					tasks[i].split = true;
+					tasks.push_back(Task{ al, bl, nullptr, nullptr, nullptr, i, false, false });
+					tasks.push_back(Task{ ar, br, nullptr, nullptr, nullptr, i, true, false });
+					continue;
 				}
 			}
+			else
+			{
+				r = combine_step(tasks[i].lo, tasks[i].keep, tasks[i].hi);
+			}
+
+			size_t parent = tasks[i].parent;
+			bool right = tasks[i].right;
+			tasks.pop_back();
+
+			if (parent == none) result = r;
+			else if (right) tasks[parent].hi = r;
+			else tasks[parent].lo = r;
+		}
+
+		return result;
+	}
+
+	/**
+	 * Private member function to call f on each node in pre-order,
+	 * with an explicit stack.
+	 */
+	template <typename F>
+	void for_each_preorder(F f) const
+	{
+		vector<BinaryNode*> pending;
+		if (root != nullptr) pending.push_back(root);
+
+		while (!pending.empty())
+		{
+			BinaryNode *t = pending.back();
+			pending.pop_back();
+			f(t);
 
-			return t;   // No match
+			if (t->right != nullptr) pending.push_back(t->right);
+			if (t->left != nullptr) pending.push_back(t->left);
 		}
-	*****************************************************/
+	}
 
 	/**
-	 * Private member function to make subtree empty.
+	 * Private member function to build a perfectly balanced subtree from
+	 * the sorted, duplicate-free items[lo, hi). Items are moved into the nodes.
+	 * Recursion depth is logarithmic in the number of items.
+	 * Return the root of the new subtree, whose parent is set to p.
 	 */
-	BinaryNode* makeEmpty(BinaryNode *t)
+	static BinaryNode* build_balanced(vector<Comparable> & items, size_t lo, size_t hi, BinaryNode *p)
 	{
-		if (t != nullptr)
+		if (lo >= hi)
+		{
+			return nullptr;
+		}
+
+		size_t mid = lo + (hi - lo) / 2;
+		BinaryNode *t = new BinaryNode{ std::move(items[mid]), nullptr, nullptr, p };
+
+		try
+		{
+			t->left = build_balanced(items, lo, mid, t);
+			t->right = build_balanced(items, mid + 1, hi, t);
+			update_size(t);
+		}
+		catch (...)
+		{
+			makeEmpty(t);
+			throw;
+		}
+
+		return t;
+	}
+
+	/**
+	 * Private member function to sort items on the threads of the shared
+	 * TaskPool. Equal slices are sorted concurrently and then merged pairwise.
+	 */
+	static void parallel_sort(vector<Comparable> & items, const Compare & comp)
+	{
+		const size_t minSlice = 1 << 14;
+		TaskPool & pool = TaskPool::shared();
+		size_t slices = std::min(pool.threads(), std::max<size_t>(1, items.size() / minSlice));
+
+		if (slices < 2)
+		{
+			std::sort(items.begin(), items.end(), comp);
+			return;
+		}
+
+		vector<size_t> bounds;
+		for (size_t i = 0; i <= slices; ++i)
 		{
-			makeEmpty(t->left);
-			makeEmpty(t->right);
-			delete t;
+			bounds.push_back(items.size() * i / slices);
 		}
 
+		pool.parallel_for(slices, [&items, &bounds, &comp](size_t i) {
+			std::sort(items.begin() + bounds[i], items.begin() + bounds[i + 1], comp);
+		});
+
+		for (size_t width = 1; width < slices; width *= 2)
+		{
+			size_t pairs = (slices - width + 2 * width - 1) / (2 * width);
+			pool.parallel_for(pairs, [&items, &bounds, &comp, width, slices](size_t k) {
+				size_t i = 2 * width * k;
+				size_t lo = bounds[i];
+				size_t mid = bounds[i + width];
+				size_t hi = bounds[std::min(i + 2 * width, slices)];
+				std::inplace_merge(items.begin() + lo, items.begin() + mid, items.begin() + hi, comp);
+			});
+		}
+	}
+
+	/**
+	 * Private member function to make subtree empty.
+	 */
+	static BinaryNode* makeEmpty(BinaryNode *t)
+	{
+		destroy(t);
 		return nullptr;
 	}
 
 	/**
-	 * Private member function to print a subtree rooted at t in sorted order.
-	 * In-order traversal is used
+	 * Private member function to delete all nodes of subtree t.
+	 * Left children are rotated up until the node to delete has none,
+	 * so no recursion or auxiliary stack is needed.
+	 * Return the number of nodes deleted.
 	 */
-	void printTree(BinaryNode *t, ostream & out, string indent) const
+	static size_t destroy(BinaryNode *t)
 	{
-		if (t != nullptr)
+		size_t count = 0;
+
+		while (t != nullptr)
 		{
-			out << indent;
-			out << t->element << endl;
-			indent += "   ";
-			printTree(t->left, out, indent);
-			printTree(t->right, out, indent);
+			if (t->left != nullptr)
+			{
+				BinaryNode *lt = t->left;
+				t->left = lt->right;
+				lt->right = t;
+				t = lt;
+			}
+			else
+			{
+				BinaryNode *rt = t->right;
+				delete t;
+				t = rt;
+				++count;
+			}
 		}
+
+		return count;
 	}
 
-	void clone_parents(BinaryNode * t, BinaryNode * lastNode)
+	/**
+	 * Private member function to print a subtree rooted at t.
+	 * Pre-order traversal is used, with an explicit stack of (node, depth)
+	 */
+	void printTree(BinaryNode *t, ostream & out, string indent) const
 	{
-		if (t == nullptr) return;
-		t->parent = lastNode;
-		clone_parents(t->left, t);
-		clone_parents(t->right, t);
+		vector<pair<BinaryNode*, size_t>> pending{ { t, 0 } };
+
+		while (!pending.empty())
+		{
+			BinaryNode *n = pending.back().first;
+			size_t depth = pending.back().second;
+			pending.pop_back();
+
+			out << indent;
+			for (size_t i = 0; i < depth; ++i) out << "   ";
+			out << n->element << endl;
+
+			if (n->right != nullptr) pending.push_back({ n->right, depth + 1 });
+			if (n->left != nullptr) pending.push_back({ n->left, depth + 1 });
+		}
 	}
 
 	/**
 	 * Private member function to clone subtree.
+	 * The copy is built in a single pre-order walk that follows the parent
+	 * pointers of the source, so the parents of the copy are set as it grows.
 	 */
 	BinaryNode * clone(BinaryNode *t) const
 	{
@@ -573,20 +2543,54 @@ private:
 		{
 			return nullptr;
 		}
-		else
-		{
-			/*
-			BinaryNode* newNode;
 
-			if(t->parent != nullptr)
-				newNode = new BinaryNode(t->parent->element, t->parent->left, t->parent->right, t->parent->parent);
-			else
-				newNode = nullptr;
-				*/
+		BinaryNode *copy = new BinaryNode{ t->element, nullptr, nullptr, nullptr };
+		BinaryNode *src = t;
+		BinaryNode *dst = copy;
 
-			return new BinaryNode{ t->element, clone(t->left), clone(t->right), nullptr };
+		try
+		{
+			while (true)
+			{
+				if (src->left != nullptr && dst->left == nullptr)
+				{
+					dst->left = new BinaryNode{ src->left->element, nullptr, nullptr, dst };
+					src = src->left;
+					dst = dst->left;
+				}
+				else if (src->right != nullptr && dst->right == nullptr)
+				{
+					dst->right = new BinaryNode{ src->right->element, nullptr, nullptr, dst };
+					src = src->right;
+					dst = dst->right;
+				}
+				else if (src != t)
+				{
+					update_size(dst);
+					src = src->parent;
+					dst = dst->parent;
+				}
+				else
+				{
+					update_size(dst);
+					break;
+				}
+			}
+		}
+		catch (...)
+		{
+			makeEmpty(copy);
+			throw;
 		}
+
+		return copy;
 	}
 };
 
+template <typename Comparable, typename Compare, bool OrderStatistics, typename Hash>
+const size_t BinarySearchTree<Comparable, Compare, OrderStatistics, Hash>::BatchWidth;
+
+template <typename Comparable, typename Compare, bool OrderStatistics, typename Hash>
+constexpr char BinarySearchTree<Comparable, Compare, OrderStatistics, Hash>::saveMagic[4];
+
 #endif
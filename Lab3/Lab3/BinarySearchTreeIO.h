@@ -0,0 +1,29 @@
+#ifndef BINARY_SEARCH_TREE_IO_H
+#define BINARY_SEARCH_TREE_IO_H
+
+#include "BinarySearchTree.h"
+#include "MappedFile.h"
+#include <string>
+using namespace std;
+
+// File input for BinarySearchTree, apart from the container so that only
+// its users pull in the platform headers of MappedFile.
+//
+// ******************PUBLIC OPERATIONS*********************
+// bool load( t, fileName ) --> Replace t by the tree saved in the file
+
+/**
+ * Replace t with the tree written by save to a file, which is
+ * memory-mapped rather than read; items of trivially copyable type are
+ * then copied straight out of the mapping.
+ * Return false, leaving t unchanged, if the file cannot be mapped or
+ * its data is malformed.
+ */
+template <typename Comparable, typename Compare, bool OrderStatistics, typename Hash>
+bool load(BinarySearchTree<Comparable, Compare, OrderStatistics, Hash> & t, const string & fileName)
+{
+	MappedFile file(fileName);
+	return file.isOpen() && t.load(file.data(), file.size());
+}
+
+#endif
@@ -0,0 +1,816 @@
+#ifndef COMPACT_BINARY_SEARCH_TREE_H
+#define COMPACT_BINARY_SEARCH_TREE_H
+
+#include "dsexceptions.h"
+#include "BinaryCodec.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+// CompactBinarySearchTree class
+//
+// CONSTRUCTION: zero parameter, or a range [first, last) of items
+//
+// A binary search tree whose nodes live in one vector and refer to each
+// other by 32-bit indices instead of pointers. A node of int then takes
+// 16 bytes instead of the 32 of a BinarySearchTree node plus the
+// allocator overhead, and the tree is copied, moved and saved without
+// fixing up any pointers. Removed nodes leave no holes: the last node of
+// the vector is moved into the freed slot.
+//
+// assign and relayout store the nodes in sorted (in-order) order, so
+// iteration then walks memory sequentially. Later inserts append nodes at
+// the end; call relayout to restore the order after many updates.
+//
+// Items are ordered by Compare (operator< by default); when Compare is
+// transparent, contains and lower_bound also accept other key types.
+//
+// ******************PUBLIC OPERATIONS*********************
+// void assign( b, e )    --> Replace contents with the items in [b, e)
+// void insert( x )       --> Insert x
+// void remove( x )       --> Remove x
+// BiIterator contains( x )    --> Return iterator to x, or end( )
+// BiIterator lower_bound( x ) --> Return iterator to first item not less than x
+// Comparable findMin( )  --> Return smallest item
+// Comparable findMax( )  --> Return largest item
+// boolean isEmpty( )     --> Return true if empty; else false
+// size_t size( )         --> Return number of items
+// void makeEmpty( )      --> Remove all items
+// void relayout( )       --> Store the nodes in sorted order, without spare capacity
+// bool save( out )       --> Write the tree in binary to a stream or file
+// bool load( in )        --> Replace the tree by one read with save
+// void printTree( )      --> Print tree in sorted order
+// ******************ITERATORS*****************************
+// Iterators stay valid when items are inserted. remove invalidates
+// iterators to the removed item and to the item that is moved into its
+// slot; relayout, assign and load invalidate all iterators.
+// ******************ERRORS********************************
+// Throws UnderflowException as warranted
+// insert throws ArrayIndexOutOfBoundsException beyond 2^32 - 1 items
+
+template <typename Comparable, typename Compare = less<>>
+class CompactBinarySearchTree
+{
+	static const uint32_t NIL = UINT32_MAX;
+
+	struct Node
+	{
+		Comparable element;
+		uint32_t left;
+		uint32_t right;
+		uint32_t parent;
+	};
+
+public:
+
+	class BiIterator
+	{
+	public:
+		BiIterator() : tree{ nullptr }, current{ NIL } { }
+
+		const Comparable & operator*() const
+		{
+			return tree->nodes[current].element;
+		}
+
+		const Comparable* operator->() const
+		{
+			return &tree->nodes[current].element;
+		}
+
+		bool operator==(const BiIterator &it) const
+		{
+			return current == it.current;
+		}
+		bool operator!=(const BiIterator &it) const
+		{
+			return current != it.current;
+		}
+
+		BiIterator& operator++()
+		{
+			current = tree->find_successor(current);
+			return *this;
+		}
+
+		BiIterator operator++(int)
+		{
+			BiIterator old = *this;
+			++*this;
+			return old;
+		}
+
+		BiIterator& operator--()
+		{
+			current = tree->find_predecessor(current);
+			return *this;
+		}
+
+		BiIterator operator--(int)
+		{
+			BiIterator old = *this;
+			--*this;
+			return old;
+		}
+	private:
+		friend class CompactBinarySearchTree;
+
+		BiIterator(const CompactBinarySearchTree *t, uint32_t i) : tree{ t }, current{ i } { }
+
+		const CompactBinarySearchTree *tree;
+		uint32_t current;
+	};
+
+	BiIterator begin() const
+	{
+		if (isEmpty()) return end();
+		return BiIterator(this, findMin(root));
+	}
+	BiIterator end() const
+	{
+		return BiIterator();
+	}
+
+	CompactBinarySearchTree() : root{ NIL }
+	{
+	}
+
+	/**
+	 * Range constructor: build a balanced tree from the items in [first, last).
+	 * Duplicates are ignored.
+	 */
+	template <typename InputIterator>
+	CompactBinarySearchTree(InputIterator first, InputIterator last) : root{ NIL }
+	{
+		assign(first, last);
+	}
+
+	/**
+	 * Replace the contents of the tree with the items in [first, last).
+	 * The items are sorted and deduplicated, and a perfectly balanced tree
+	 * is built from them in sorted layout: the k-th smallest item is in
+	 * node k.
+	 */
+	template <typename InputIterator>
+	void assign(InputIterator first, InputIterator last)
+	{
+		vector<Comparable> items(first, last);
+
+		if (!std::is_sorted(items.begin(), items.end(), comp))
+		{
+			std::sort(items.begin(), items.end(), comp);
+		}
+
+		auto equivalent = [this](const Comparable & a, const Comparable & b) { return !comp(a, b); };
+		items.erase(std::unique(items.begin(), items.end(), equivalent), items.end());
+		check_capacity(items.size());
+
+		vector<Node> newNodes;
+		newNodes.reserve(items.size());
+		for (auto & x : items)
+		{
+			newNodes.push_back(Node{ std::move(x), NIL, NIL, NIL });
+		}
+
+		nodes.swap(newNodes);
+		root = link_balanced(0, static_cast<uint32_t>(nodes.size()), NIL);
+	}
+
+	/**
+	 * Find the smallest item in the tree.
+	 * Throw UnderflowException if empty.
+	 */
+	const Comparable & findMin() const
+	{
+		if (isEmpty())
+		{
+			throw UnderflowException{ };
+		}
+
+		return nodes[findMin(root)].element;
+	}
+
+	/**
+	 * Find the largest item in the tree.
+	 * Throw UnderflowException if empty.
+	 */
+	const Comparable & findMax() const
+	{
+		if (isEmpty())
+		{
+			throw UnderflowException{ };
+		}
+
+		return nodes[findMax(root)].element;
+	}
+
+	/**
+	 * Return an iterator to x, or end( ) if x is not found.
+	 */
+	BiIterator contains(const Comparable & x) const
+	{
+		return BiIterator(this, find(x));
+	}
+
+	/**
+	 * Heterogeneous version of contains, for transparent comparators only.
+	 */
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	BiIterator contains(const K & x) const
+	{
+		return BiIterator(this, find(x));
+	}
+
+	/**
+	 * Return an iterator to the first item not less than x, or end( ).
+	 */
+	BiIterator lower_bound(const Comparable & x) const
+	{
+		return BiIterator(this, lower_bound_index(x));
+	}
+
+	/**
+	 * Heterogeneous version of lower_bound, for transparent comparators only.
+	 */
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	BiIterator lower_bound(const K & x) const
+	{
+		return BiIterator(this, lower_bound_index(x));
+	}
+
+	/**
+	 * Test if the tree is logically empty.
+	 * Return true if empty, false otherwise.
+	 */
+	bool isEmpty() const
+	{
+		return root == NIL;
+	}
+
+	/**
+	 * Return the number of items in the tree.
+	 */
+	size_t size() const
+	{
+		return nodes.size();
+	}
+
+	/**
+	 * Make the tree logically empty and release its memory.
+	 */
+	void makeEmpty()
+	{
+		vector<Node>{ }.swap(nodes);
+		root = NIL;
+	}
+
+	/**
+	 * Insert x into the tree; duplicates are ignored.
+	 */
+	void insert(const Comparable & x)
+	{
+		insert_node(x);
+	}
+
+	/**
+	 * Insert x into the tree; duplicates are ignored.
+	 */
+	void insert(Comparable && x)
+	{
+		insert_node(std::move(x));
+	}
+
+	/**
+	 * Remove x from the tree. Nothing is done if x is not found.
+	 */
+	void remove(const Comparable & x)
+	{
+		uint32_t t = find(x);
+
+		if (t != NIL)
+		{
+			remove_node(t);
+		}
+	}
+
+	/**
+	 * Renumber the nodes in sorted order, so that the k-th smallest item is
+	 * in node k, and drop any spare capacity. The shape is unchanged.
+	 * Costs O(n) time and O(n) extra memory.
+	 */
+	void relayout()
+	{
+		vector<uint32_t> order;     // order[k] = old index of the k-th smallest
+		order.reserve(nodes.size());
+		for (uint32_t t = isEmpty() ? NIL : findMin(root); t != NIL; t = find_successor(t))
+		{
+			order.push_back(t);
+		}
+
+		vector<uint32_t> newIndex(nodes.size());
+		for (uint32_t k = 0; k < order.size(); ++k)
+		{
+			newIndex[order[k]] = k;
+		}
+
+		auto renumber = [&newIndex](uint32_t i) { return (i == NIL) ? NIL : newIndex[i]; };
+
+		vector<Node> newNodes;
+		newNodes.reserve(nodes.size());
+		for (uint32_t old : order)
+		{
+			Node & n = nodes[old];
+			newNodes.push_back(Node{ std::move(n.element), renumber(n.left), renumber(n.right), renumber(n.parent) });
+		}
+
+		nodes.swap(newNodes);
+		root = renumber(root);
+	}
+
+	/**
+	 * Write the tree in binary to out: a header, then the left and right
+	 * child index of every node, then the items, all in sorted layout.
+	 * The tree is read back with load, without searching or rebalancing.
+	 * Return false if writing fails.
+	 */
+	bool save(ostream & out) const
+	{
+		vector<uint32_t> order;
+		order.reserve(nodes.size());
+		for (uint32_t t = isEmpty() ? NIL : findMin(root); t != NIL; t = find_successor(t))
+		{
+			order.push_back(t);
+		}
+
+		vector<uint32_t> newIndex(nodes.size());
+		for (uint32_t k = 0; k < order.size(); ++k)
+		{
+			newIndex[order[k]] = k;
+		}
+
+		auto renumber = [&newIndex](uint32_t i) { return (i == NIL) ? NIL : newIndex[i]; };
+
+		string buf(saveMagic, sizeof(saveMagic));
+		uint32_t keySize = static_cast<uint32_t>(BinaryCodec<Comparable>::fixedSize);
+		uint64_t count = nodes.size();
+		uint32_t top = renumber(root);
+		buf.append(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+		buf.append(reinterpret_cast<const char*>(&count), sizeof(count));
+		buf.append(reinterpret_cast<const char*>(&top), sizeof(top));
+
+		for (uint32_t old : order)
+		{
+			uint32_t links[2] = { renumber(nodes[old].left), renumber(nodes[old].right) };
+			buf.append(reinterpret_cast<const char*>(links), sizeof(links));
+		}
+
+		for (uint32_t old : order)
+		{
+			BinaryCodec<Comparable>::write(buf, nodes[old].element);
+			if (buf.size() >= (1 << 16))
+			{
+				out.write(buf.data(), buf.size());
+				buf.clear();
+			}
+		}
+		out.write(buf.data(), buf.size());
+
+		return static_cast<bool>(out);
+	}
+
+	bool save(const string & fileName) const
+	{
+		ofstream out(fileName, ios::binary);
+		return out && save(out);
+	}
+
+	/**
+	 * Replace the tree with one written by save. The nodes are read in
+	 * sorted layout, so this is the same as a relayout.
+	 * Return false, leaving the tree unchanged, if the data is malformed.
+	 */
+	bool load(istream & in)
+	{
+		string data{ istreambuf_iterator<char>{ in }, istreambuf_iterator<char>{ } };
+		return load(data.data(), data.size());
+	}
+
+	/**
+	 * Load from a file, which is memory-mapped rather than read.
+	 */
+	bool load(const string & fileName)
+	{
+		MappedFile file(fileName);
+		return file.isOpen() && load(file.data(), file.size());
+	}
+
+	/**
+	 * Print the tree contents in sorted order.
+	 */
+	void printTree(ostream & out = cout) const
+	{
+		if (isEmpty())
+		{
+			out << "Empty tree" << endl;
+		}
+		else
+		{
+			printTree(root, out);
+		}
+	}
+
+private:
+	static constexpr char saveMagic[4] = { 'C', 'B', 'T', '1' };
+
+	vector<Node> nodes;
+	uint32_t root;
+	Compare comp;
+
+	/**
+	 * Throw ArrayIndexOutOfBoundsException if n nodes cannot be indexed.
+	 */
+	static void check_capacity(size_t n)
+	{
+		if (n >= NIL)
+		{
+			throw ArrayIndexOutOfBoundsException{ };
+		}
+	}
+
+	/**
+	 * Private member function to return the link (root or a child index)
+	 * that refers to node t.
+	 */
+	uint32_t & link_to(uint32_t t)
+	{
+		uint32_t p = nodes[t].parent;
+
+		if (p == NIL) return root;
+		return (nodes[p].left == t) ? nodes[p].left : nodes[p].right;
+	}
+
+	/**
+	 * Private member function to find the node storing x.
+	 * Return NIL if x is not found.
+	 */
+	template <typename K>
+	uint32_t find(const K & x) const
+	{
+		uint32_t t = root;
+
+		while (t != NIL)
+		{
+			const Node & n = nodes[t];
+
+			if (comp(x, n.element))
+			{
+				t = n.left;
+			}
+			else if (comp(n.element, x))
+			{
+				t = n.right;
+			}
+			else
+			{
+				break;    // Match
+			}
+		}
+
+		return t;
+	}
+
+	/**
+	 * Private member function to find the node storing the first item
+	 * not less than x, or NIL.
+	 */
+	template <typename K>
+	uint32_t lower_bound_index(const K & x) const
+	{
+		uint32_t t = root;
+		uint32_t result = NIL;
+
+		while (t != NIL)
+		{
+			if (comp(nodes[t].element, x))
+			{
+				t = nodes[t].right;
+			}
+			else
+			{
+				result = t;
+				t = nodes[t].left;
+			}
+		}
+
+		return result;
+	}
+
+	/**
+	 * Private member function to insert x as a new leaf; duplicates are
+	 * ignored. The link is set by index after the node is appended, since
+	 * appending may reallocate the vector.
+	 */
+	template <typename X>
+	void insert_node(X && x)
+	{
+		uint32_t parent = NIL;
+		bool asLeft = false;
+
+		for (uint32_t t = root; t != NIL; )
+		{
+			parent = t;
+
+			if (comp(x, nodes[t].element))
+			{
+				asLeft = true;
+				t = nodes[t].left;
+			}
+			else if (comp(nodes[t].element, x))
+			{
+				asLeft = false;
+				t = nodes[t].right;
+			}
+			else
+			{
+				return;  // Duplicate; do nothing
+			}
+		}
+
+		check_capacity(nodes.size() + 1);
+		uint32_t n = static_cast<uint32_t>(nodes.size());
+		nodes.push_back(Node{ std::forward<X>(x), NIL, NIL, parent });
+
+		if (parent == NIL)
+			root = n;
+		else if (asLeft)
+			nodes[parent].left = n;
+		else
+			nodes[parent].right = n;
+	}
+
+	/**
+	 * Private member function to remove node t. A node with two children
+	 * is replaced by its successor node, which is relinked into its place.
+	 * The slot of t is then refilled with the last node of the vector.
+	 */
+	void remove_node(uint32_t t)
+	{
+		Node & n = nodes[t];
+
+		if (n.left != NIL && n.right != NIL) // Two children
+		{
+			uint32_t succ = findMin(n.right);
+			Node & s = nodes[succ];
+
+			if (s.parent != t)
+			{
+				nodes[s.parent].left = s.right;
+				if (s.right != NIL) nodes[s.right].parent = s.parent;
+				s.right = n.right;
+				nodes[s.right].parent = succ;
+			}
+
+			s.left = n.left;
+			nodes[s.left].parent = succ;
+			link_to(t) = succ;
+			s.parent = n.parent;
+		}
+		else
+		{
+			uint32_t child = (n.left != NIL) ? n.left : n.right;
+			link_to(t) = child;
+			if (child != NIL) nodes[child].parent = n.parent;
+		}
+
+		release(t);
+	}
+
+	/**
+	 * Private member function to free the slot of unlinked node t by moving
+	 * the last node into it and redirecting the links to that node.
+	 */
+	void release(uint32_t t)
+	{
+		uint32_t last = static_cast<uint32_t>(nodes.size() - 1);
+
+		if (t != last)
+		{
+			link_to(last) = t;
+			nodes[t] = std::move(nodes[last]);
+			if (nodes[t].left != NIL) nodes[nodes[t].left].parent = t;
+			if (nodes[t].right != NIL) nodes[nodes[t].right].parent = t;
+		}
+
+		nodes.pop_back();
+	}
+
+	/**
+	 * Private member function to link the sorted nodes[lo, hi) into a
+	 * perfectly balanced subtree whose parent is p.
+	 * Recursion depth is logarithmic in the number of nodes.
+	 * Return the index of the subtree root, or NIL if the range is empty.
+	 */
+	uint32_t link_balanced(uint32_t lo, uint32_t hi, uint32_t p)
+	{
+		if (lo >= hi)
+		{
+			return NIL;
+		}
+
+		uint32_t mid = lo + (hi - lo) / 2;
+		nodes[mid].parent = p;
+		nodes[mid].left = link_balanced(lo, mid, mid);
+		nodes[mid].right = link_balanced(mid + 1, hi, mid);
+		return mid;
+	}
+
+	/**
+	 * Private member function to read a tree written by save.
+	 * The children are checked to form one tree whose in-order traversal
+	 * visits the nodes 0, 1, 2, ... in turn; parents are set on the way.
+	 */
+	bool load(const char *data, size_t size)
+	{
+		const char *p = data;
+		const char *end = data + size;
+		uint32_t keySize;
+		uint64_t count;
+		uint32_t top;
+
+		if (size < sizeof(saveMagic) + sizeof(keySize) + sizeof(count) + sizeof(top) ||
+			memcmp(p, saveMagic, sizeof(saveMagic)) != 0)
+		{
+			return false;
+		}
+		p += sizeof(saveMagic);
+		memcpy(&keySize, p, sizeof(keySize));
+		p += sizeof(keySize);
+		memcpy(&count, p, sizeof(count));
+		p += sizeof(count);
+		memcpy(&top, p, sizeof(top));
+		p += sizeof(top);
+
+		const size_t fixedSize = BinaryCodec<Comparable>::fixedSize;
+		const uint64_t linkBytes = count * 2 * sizeof(uint32_t);
+		if (keySize != fixedSize || count >= NIL || static_cast<uint64_t>(end - p) < linkBytes ||
+			(fixedSize != 0 && (static_cast<uint64_t>(end - p) - linkBytes) / fixedSize != count))
+		{
+			return false;
+		}
+
+		vector<Node> newNodes(count, Node{ Comparable{ }, NIL, NIL, NIL });
+		for (auto & n : newNodes)
+		{
+			memcpy(&n.left, p, sizeof(n.left));
+			memcpy(&n.right, p + sizeof(n.left), sizeof(n.right));
+			p += sizeof(n.left) + sizeof(n.right);
+		}
+
+		// In-order walk with an explicit stack of pending ancestors
+		uint32_t next = 0;
+		vector<uint32_t> pending;
+		uint32_t t = (count == 0) ? NIL : top;
+		if (count == 0 && top != NIL) return false;
+
+		while (t != NIL || !pending.empty())
+		{
+			for (; t != NIL; t = newNodes[t].left)
+			{
+				if (t >= count || pending.size() >= count) return false;
+				uint32_t lt = newNodes[t].left;
+				if (lt != NIL)
+				{
+					if (lt >= count) return false;
+					newNodes[lt].parent = t;
+				}
+				pending.push_back(t);
+			}
+
+			t = pending.back();
+			pending.pop_back();
+			if (t != next++) return false;   // not in sorted layout, or not a tree
+
+			uint32_t rt = newNodes[t].right;
+			if (rt != NIL)
+			{
+				if (rt >= count) return false;
+				newNodes[rt].parent = t;
+			}
+			t = rt;
+		}
+
+		if (next != count) return false;
+
+		for (auto & n : newNodes)
+		{
+			if (!BinaryCodec<Comparable>::read(p, end, n.element)) return false;
+		}
+		if (p != end) return false;
+
+		nodes.swap(newNodes);
+		root = (count == 0) ? NIL : top;
+		return true;
+	}
+
+	/**
+	 * Private member function to find the smallest item in subtree t.
+	 */
+	uint32_t findMin(uint32_t t) const
+	{
+		while (nodes[t].left != NIL)
+		{
+			t = nodes[t].left;
+		}
+
+		return t;
+	}
+
+	/**
+	 * Private member function to find the largest item in subtree t.
+	 */
+	uint32_t findMax(uint32_t t) const
+	{
+		while (nodes[t].right != NIL)
+		{
+			t = nodes[t].right;
+		}
+
+		return t;
+	}
+
+	/**
+	 * Private member function to find the in-order successor of node t.
+	 * Return NIL if t is the largest item (or NIL).
+	 */
+	uint32_t find_successor(uint32_t t) const
+	{
+		if (t == NIL) return NIL;
+		if (nodes[t].right != NIL) return findMin(nodes[t].right);
+
+		uint32_t p = nodes[t].parent;
+		while (p != NIL && t == nodes[p].right)
+		{
+			t = p;
+			p = nodes[p].parent;
+		}
+
+		return p;
+	}
+
+	/**
+	 * Private member function to find the in-order predecessor of node t.
+	 * Return NIL if t is the smallest item (or NIL).
+	 */
+	uint32_t find_predecessor(uint32_t t) const
+	{
+		if (t == NIL) return NIL;
+		if (nodes[t].left != NIL) return findMax(nodes[t].left);
+
+		uint32_t p = nodes[t].parent;
+		while (p != NIL && t == nodes[p].left)
+		{
+			t = p;
+			p = nodes[p].parent;
+		}
+
+		return p;
+	}
+
+	/**
+	 * Private member function to print the subtree t in pre-order,
+	 * indented three spaces per level.
+	 */
+	void printTree(uint32_t t, ostream & out) const
+	{
+		vector<pair<uint32_t, size_t>> pending{ { t, 0 } };
+
+		while (!pending.empty())
+		{
+			const Node & n = nodes[pending.back().first];
+			size_t depth = pending.back().second;
+			pending.pop_back();
+
+			for (size_t i = 0; i < depth; ++i) out << "   ";
+			out << n.element << endl;
+
+			if (n.right != NIL) pending.push_back({ n.right, depth + 1 });
+			if (n.left != NIL) pending.push_back({ n.left, depth + 1 });
+		}
+	}
+};
+
+template <typename Comparable, typename Compare>
+const uint32_t CompactBinarySearchTree<Comparable, Compare>::NIL;
+
+template <typename Comparable, typename Compare>
+constexpr char CompactBinarySearchTree<Comparable, Compare>::saveMagic[4];
+
+#endif
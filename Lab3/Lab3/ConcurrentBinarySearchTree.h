@@ -0,0 +1,516 @@
+#ifndef CONCURRENT_BINARY_SEARCH_TREE_H
+#define CONCURRENT_BINARY_SEARCH_TREE_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <cstdint>
+using namespace std;
+
+// ConcurrentBinarySearchTree class
+//
+// A binary search tree for many reader threads and one writer at a time.
+// Readers never block: they work on a Snapshot, an immutable version of the
+// tree that stays valid until the Snapshot is destroyed.
+//
+// Writers copy the path from the root to the changed node (path copying) and
+// publish the new root with one atomic store, so published nodes are never
+// modified and readers see either the old or the new version, never a mix.
+// Replaced nodes are freed by epoch-based reclamation once no reader that
+// might still see them is active. Nodes have no parent pointers, because a
+// shared subtree has a parent in every version.
+//
+// CONSTRUCTION: zero parameter
+//
+// ******************PUBLIC OPERATIONS*********************
+// bool insert( x )       --> Insert x; return false for duplicates
+// bool remove( x )       --> Remove x; return false if x is not found
+// bool contains( x )     --> Return true if x is present
+// void makeEmpty( )      --> Remove all items
+// Snapshot snapshot( )   --> Pin the current version for reading
+// ******************SNAPSHOT OPERATIONS*******************
+// const Comparable* contains( x )    --> Return pointer to x, or nullptr
+// const Comparable* lower_bound( x ) --> Return pointer to first item not less than x
+// iterator begin( ), end( )          --> Iterate in sorted order
+// ******************CONCURRENCY***************************
+// insert, remove and makeEmpty are serialized by a mutex.
+// contains and all Snapshot operations are lock-free.
+// At most MaxReaders snapshots are pinned at a time; further readers spin.
+// The tree must not be destroyed while Snapshots of it exist.
+
+template <typename Comparable, typename Compare = less<>>
+class ConcurrentBinarySearchTree
+{
+	struct Node
+	{
+		const Comparable element;
+		Node *left;
+		Node *right;
+
+		Node(const Comparable & theElement, Node *lt, Node *rt)
+			: element{ theElement }, left{ lt }, right{ rt } { }
+	};
+
+	static const size_t MaxReaders = 128;
+
+	// One per concurrent reader; a cache line each to avoid false sharing
+	struct alignas(64) ReaderSlot
+	{
+		atomic<uint64_t> epoch{ 0 };  // 0 when free
+	};
+
+public:
+
+	class iterator;
+
+	/**
+	 * A pinned version of the tree. Nodes reachable from it are not freed
+	 * until the Snapshot is destroyed.
+	 */
+	class Snapshot
+	{
+	public:
+		Snapshot(Snapshot && rhs) : tree{ rhs.tree }, slot{ rhs.slot }, top{ rhs.top }
+		{
+			rhs.slot = nullptr;
+		}
+
+		Snapshot(const Snapshot &) = delete;
+		Snapshot & operator=(const Snapshot &) = delete;
+
+		~Snapshot()
+		{
+			if (slot != nullptr) slot->epoch.store(0, memory_order_release);
+		}
+
+		template <typename K>
+		const Comparable* contains(const K & x) const
+		{
+			const Node *t = top;
+
+			while (t != nullptr)
+			{
+				if (tree->comp(x, t->element))
+				{
+					t = t->left;
+				}
+				else if (tree->comp(t->element, x))
+				{
+					t = t->right;
+				}
+				else
+				{
+					return &t->element;    // Match
+				}
+			}
+
+			return nullptr;   // No match
+		}
+
+		template <typename K>
+		const Comparable* lower_bound(const K & x) const
+		{
+			const Node *t = top;
+			const Node *result = nullptr;
+
+			while (t != nullptr)
+			{
+				if (tree->comp(t->element, x))
+				{
+					t = t->right;
+				}
+				else
+				{
+					result = t;
+					t = t->left;
+				}
+			}
+
+			return (result != nullptr) ? &result->element : nullptr;
+		}
+
+		iterator begin() const
+		{
+			return iterator(top);
+		}
+
+		iterator end() const
+		{
+			return iterator();
+		}
+
+	private:
+		friend class ConcurrentBinarySearchTree;
+
+		Snapshot(const ConcurrentBinarySearchTree *t, ReaderSlot *s, const Node *r)
+			: tree{ t }, slot{ s }, top{ r } { }
+
+		const ConcurrentBinarySearchTree *tree;
+		ReaderSlot *slot;
+		const Node *top;
+	};
+
+	/**
+	 * Forward iterator over a Snapshot, in sorted order.
+	 * Without parent pointers, it keeps the path of pending ancestors.
+	 */
+	class iterator
+	{
+	public:
+		iterator() { }
+
+		const Comparable & operator*() const
+		{
+			return pending.back()->element;
+		}
+
+		const Comparable* operator->() const
+		{
+			return &pending.back()->element;
+		}
+
+		bool operator==(const iterator &it) const
+		{
+			return current() == it.current();
+		}
+		bool operator!=(const iterator &it) const
+		{
+			return current() != it.current();
+		}
+
+		iterator& operator++()
+		{
+			const Node *t = pending.back()->right;
+			pending.pop_back();
+			push_left(t);
+			return *this;
+		}
+
+	private:
+		friend class Snapshot;
+
+		explicit iterator(const Node *t)
+		{
+			push_left(t);
+		}
+
+		void push_left(const Node *t)
+		{
+			for (; t != nullptr; t = t->left)
+			{
+				pending.push_back(t);
+			}
+		}
+
+		const Node* current() const
+		{
+			return pending.empty() ? nullptr : pending.back();
+		}
+
+		vector<const Node*> pending;
+	};
+
+	ConcurrentBinarySearchTree() : root{ nullptr }
+	{
+	}
+
+	ConcurrentBinarySearchTree(const ConcurrentBinarySearchTree &) = delete;
+	ConcurrentBinarySearchTree & operator=(const ConcurrentBinarySearchTree &) = delete;
+
+	/**
+	 * Destructor for the tree; no Snapshot may be alive.
+	 */
+	~ConcurrentBinarySearchTree()
+	{
+		destroy(root.load());
+		for (auto & r : retired)
+		{
+			delete r.first;
+		}
+	}
+
+	/**
+	 * Pin the current version of the tree for lock-free reading.
+	 */
+	Snapshot snapshot() const
+	{
+		ReaderSlot *slot = acquire_slot();
+		return Snapshot(this, slot, root.load());
+	}
+
+	/**
+	 * Returns true if x is found in the tree.
+	 */
+	template <typename K>
+	bool contains(const K & x) const
+	{
+		return snapshot().contains(x) != nullptr;
+	}
+
+	/**
+	 * Insert x into the tree; duplicates are ignored.
+	 * Return true if x was inserted.
+	 */
+	bool insert(const Comparable & x)
+	{
+		lock_guard<mutex> lock{ writeLock };
+		vector<pair<Node*, bool>> path;
+
+		for (Node *t = root.load(); t != nullptr; )
+		{
+			if (comp(x, t->element))
+			{
+				path.push_back({ t, true });
+				t = t->left;
+			}
+			else if (comp(t->element, x))
+			{
+				path.push_back({ t, false });
+				t = t->right;
+			}
+			else
+			{
+				return false;  // Duplicate; do nothing
+			}
+		}
+
+		vector<Node*> created;
+		Node *leaf = new_node(x, nullptr, nullptr, created);
+		publish(copy_path(path, leaf, created));
+		retire_path(path);
+		reclaim();
+		return true;
+	}
+
+	/**
+	 * Remove x from the tree.
+	 * Return false if x is not found.
+	 */
+	template <typename K>
+	bool remove(const K & x)
+	{
+		lock_guard<mutex> lock{ writeLock };
+		vector<pair<Node*, bool>> path;
+		Node *t = root.load();
+
+		while (t != nullptr)
+		{
+			if (comp(x, t->element))
+			{
+				path.push_back({ t, true });
+				t = t->left;
+			}
+			else if (comp(t->element, x))
+			{
+				path.push_back({ t, false });
+				t = t->right;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if (t == nullptr) return false;  // Item not found
+
+		vector<Node*> created;
+		vector<pair<Node*, bool>> rightPath;
+		Node *succ = nullptr;
+		Node *replacement;
+
+		if (t->left == nullptr || t->right == nullptr)
+		{
+			replacement = (t->left != nullptr) ? t->left : t->right;
+		}
+		else // Two children: a copy of the successor takes the place of t
+		{
+			succ = t->right;
+			while (succ->left != nullptr)
+			{
+				rightPath.push_back({ succ, true });
+				succ = succ->left;
+			}
+
+			Node *newRight = copy_path(rightPath, succ->right, created);
+			replacement = new_node(succ->element, t->left, newRight, created);
+		}
+
+		publish(copy_path(path, replacement, created));
+		retire_path(path);
+		retire_path(rightPath);
+		if (succ != nullptr) retire(succ);
+		retire(t);
+		reclaim();
+		return true;
+	}
+
+	/**
+	 * Make the tree logically empty.
+	 */
+	void makeEmpty()
+	{
+		lock_guard<mutex> lock{ writeLock };
+		Node *old = root.load();
+		publish(nullptr);
+
+		vector<Node*> pending;
+		if (old != nullptr) pending.push_back(old);
+
+		while (!pending.empty())
+		{
+			Node *t = pending.back();
+			pending.pop_back();
+			if (t->left != nullptr) pending.push_back(t->left);
+			if (t->right != nullptr) pending.push_back(t->right);
+			retire(t);
+		}
+
+		reclaim();
+	}
+
+private:
+	atomic<Node*> root;
+	Compare comp;
+
+	mutex writeLock;
+	atomic<uint64_t> globalEpoch{ 1 };
+	mutable ReaderSlot readers[MaxReaders];
+	vector<pair<Node*, uint64_t>> retired;  // written only under writeLock
+
+	/**
+	 * Claim a free reader slot and announce the current epoch in it.
+	 * The epoch is announced before the root is read, so a writer that
+	 * retires nodes after the read sees the slot and keeps them.
+	 */
+	ReaderSlot* acquire_slot() const
+	{
+		size_t i = hash<thread::id>{}(this_thread::get_id()) % MaxReaders;
+
+		while (true)
+		{
+			for (size_t n = 0; n < MaxReaders; ++n, i = (i + 1) % MaxReaders)
+			{
+				uint64_t idle = 0;
+				if (readers[i].epoch.compare_exchange_strong(idle, globalEpoch.load()))
+				{
+					return &readers[i];
+				}
+			}
+			this_thread::yield();
+		}
+	}
+
+	/**
+	 * Private member function to allocate a node for a new version.
+	 * If allocation fails, all nodes created for that version are freed.
+	 */
+	Node* new_node(const Comparable & x, Node *lt, Node *rt, vector<Node*> & created)
+	{
+		try
+		{
+			created.push_back(nullptr);
+			created.back() = new Node{ x, lt, rt };
+			return created.back();
+		}
+		catch (...)
+		{
+			for (Node *n : created) delete n;
+			throw;
+		}
+	}
+
+	/**
+	 * Private member function to copy the nodes of path bottom-up, with the
+	 * last node's child in the direction taken replaced by child.
+	 * Return the copy of the first node of path, or child if path is empty.
+	 */
+	Node* copy_path(const vector<pair<Node*, bool>> & path, Node *child, vector<Node*> & created)
+	{
+		for (auto i = path.rbegin(); i != path.rend(); ++i)
+		{
+			Node *t = i->first;
+			child = i->second ? new_node(t->element, child, t->right, created)
+				: new_node(t->element, t->left, child, created);
+		}
+
+		return child;
+	}
+
+	/**
+	 * Private member function to make newRoot the current version.
+	 * Nodes of the old version that newRoot no longer references must be
+	 * retired afterwards, never before.
+	 */
+	void publish(Node *newRoot)
+	{
+		root.store(newRoot);
+	}
+
+	void retire_path(const vector<pair<Node*, bool>> & path)
+	{
+		for (auto & p : path)
+		{
+			retire(p.first);
+		}
+	}
+
+	void retire(Node *t)
+	{
+		retired.push_back({ t, globalEpoch.load() });
+	}
+
+	/**
+	 * Private member function to advance the epoch and free the retired
+	 * nodes that no active reader can reach.
+	 */
+	void reclaim()
+	{
+		globalEpoch.fetch_add(1);
+		if (retired.size() < 64) return;
+
+		uint64_t oldest = globalEpoch.load();
+		for (auto & r : readers)
+		{
+			uint64_t e = r.epoch.load();
+			if (e != 0 && e < oldest) oldest = e;
+		}
+
+		size_t kept = 0;
+		for (auto & r : retired)
+		{
+			if (r.second < oldest)
+				delete r.first;
+			else
+				retired[kept++] = r;
+		}
+		retired.resize(kept);
+	}
+
+	/**
+	 * Private member function to delete all nodes of subtree t.
+	 */
+	static void destroy(Node *t)
+	{
+		while (t != nullptr)
+		{
+			if (t->left != nullptr)
+			{
+				Node *lt = t->left;
+				t->left = lt->right;
+				lt->right = t;
+				t = lt;
+			}
+			else
+			{
+				Node *rt = t->right;
+				delete t;
+				t = rt;
+			}
+		}
+	}
+};
+
+#endif
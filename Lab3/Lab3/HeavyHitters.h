@@ -0,0 +1,269 @@
+#ifndef HEAVY_HITTERS_H
+#define HEAVY_HITTERS_H
+
+#include "dsexceptions.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+using namespace std;
+
+// CountMinSketch class
+//
+// CONSTRUCTION: with the error bound epsilon and failure probability delta
+//
+// Approximate counts of items in a stream in fixed memory: depth( ) rows of
+// width( ) counters, with width = ceil(e / epsilon) and depth =
+// ceil(ln(1 / delta)). Items are given by a 64-bit hash. An estimate never
+// undercounts, and with probability at least 1 - delta it overcounts by at
+// most epsilon * total( ). Counters are updated conservatively: only those
+// that would otherwise fall below the new estimate are raised, which keeps
+// the bound and makes overcounting rarer.
+//
+// ******************PUBLIC OPERATIONS*********************
+// uint64_t add( h, c )   --> Count item h c more times; return its new estimate
+// uint64_t estimate( h ) --> Return the estimated count of item h
+// uint64_t total( )      --> Return the number of items counted
+// ******************ERRORS********************************
+// Throws IllegalArgumentException unless 0 < epsilon and 0 < delta < 1
+
+class CountMinSketch
+{
+public:
+	CountMinSketch(double epsilon, double delta)
+	{
+		if (!(epsilon > 0) || !(delta > 0 && delta < 1))
+		{
+			throw IllegalArgumentException{ };
+		}
+
+		w = static_cast<size_t>(ceil(exp(1.0) / epsilon));
+		d = max<size_t>(1, static_cast<size_t>(ceil(log(1 / delta))));
+		counters.assign(w * d, 0);
+	}
+
+	uint64_t add(uint64_t h, uint64_t c = 1)
+	{
+		uint64_t est = estimate(h) + c;
+
+		for (size_t row = 0; row < d; ++row)
+		{
+			uint64_t & counter = counters[cell(row, h)];
+			if (counter < est) counter = est;
+		}
+
+		n += c;
+		return est;
+	}
+
+	uint64_t estimate(uint64_t h) const
+	{
+		uint64_t est = UINT64_MAX;
+
+		for (size_t row = 0; row < d; ++row)
+		{
+			est = min(est, counters[cell(row, h)]);
+		}
+
+		return est;
+	}
+
+	uint64_t total() const
+	{
+		return n;
+	}
+
+	size_t width() const
+	{
+		return w;
+	}
+
+	size_t depth() const
+	{
+		return d;
+	}
+
+private:
+	size_t w;
+	size_t d;
+	vector<uint64_t> counters;  // row after row
+	uint64_t n = 0;
+
+	/**
+	 * Return the counter of item h in row. The row hashes are derived from
+	 * h by double hashing, h1 + row * h2, with h2 odd.
+	 */
+	size_t cell(size_t row, uint64_t h) const
+	{
+		uint64_t h2 = mix(h) | 1;
+		return row * w + static_cast<size_t>((h + row * h2) % w);
+	}
+
+	static uint64_t mix(uint64_t x)
+	{
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		return x;
+	}
+};
+
+// HeavyHitters class
+//
+// CONSTRUCTION: with k and the error bounds of the CountMinSketch
+//
+// Approximate top-k most frequent words of an unbounded stream in memory
+// that does not grow with the stream. Every word is counted in a
+// CountMinSketch, and the k words with the largest estimates seen so far
+// are kept as candidates in a min-heap on their estimates. A word displaces
+// the smallest candidate as soon as its estimate exceeds that candidate's.
+//
+// ******************PUBLIC OPERATIONS*********************
+// void add( w )          --> Count word w once
+// vector top( )          --> Return the candidates and their estimated
+//                            counts, most frequent first, ties by word
+// uint64_t total( )      --> Return the number of words counted
+// uint64_t errorBound( ) --> Return the overcount bound epsilon * total( )
+
+class HeavyHitters
+{
+public:
+	HeavyHitters(size_t k, double epsilon = 1e-4, double delta = 0.01)
+		: sketch{ epsilon, delta }, capacity{ k }, epsilon{ epsilon }
+	{
+		heap.reserve(k);
+	}
+
+	void add(const string & w)
+	{
+		add(w.data(), w.size());
+	}
+
+	void add(const char *s, size_t n)
+	{
+		uint64_t h = hash_of(s, n);
+		uint64_t est = sketch.add(h);
+
+		auto it = position.find(h);
+		if (it != position.end())
+		{
+			Candidate & c = heap[it->second];
+			// Different words with the same 64-bit hash are counted as one
+			// in the sketch anyway; only the first is kept as a candidate
+			if (c.word.size() == n && c.word.compare(0, n, s, n) == 0)
+			{
+				c.count = est;
+				sift_down(it->second);
+			}
+			return;
+		}
+
+		if (heap.size() < capacity)
+		{
+			heap.push_back(Candidate{ string(s, n), h, est });
+			position[h] = heap.size() - 1;
+			sift_up(heap.size() - 1);
+		}
+		else if (capacity > 0 && est > heap[0].count)
+		{
+			position.erase(heap[0].hash);
+			heap[0] = Candidate{ string(s, n), h, est };
+			position[h] = 0;
+			sift_down(0);
+		}
+	}
+
+	vector<pair<string, uint64_t>> top() const
+	{
+		vector<pair<string, uint64_t>> result;
+		for (auto & c : heap)
+		{
+			result.push_back({ c.word, c.count });
+		}
+
+		sort(result.begin(), result.end(), [](const pair<string, uint64_t> & a, const pair<string, uint64_t> & b) {
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		});
+		return result;
+	}
+
+	uint64_t total() const
+	{
+		return sketch.total();
+	}
+
+	uint64_t errorBound() const
+	{
+		return static_cast<uint64_t>(ceil(epsilon * sketch.total()));
+	}
+
+private:
+	struct Candidate
+	{
+		string word;
+		uint64_t hash;
+		uint64_t count;
+	};
+
+	CountMinSketch sketch;
+	size_t capacity;
+	double epsilon;
+	vector<Candidate> heap;                    // min-heap on count
+	unordered_map<uint64_t, size_t> position;  // hash of a candidate -> index in heap
+
+	/**
+	 * 64-bit FNV-1a hash of s[0, n).
+	 */
+	static uint64_t hash_of(const char *s, size_t n)
+	{
+		uint64_t h = 0xcbf29ce484222325ULL;
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			h ^= static_cast<unsigned char>(s[i]);
+			h *= 0x100000001b3ULL;
+		}
+
+		return h;
+	}
+
+	void place(size_t i, Candidate && c)
+	{
+		position[c.hash] = i;
+		heap[i] = std::move(c);
+	}
+
+	void sift_up(size_t i)
+	{
+		Candidate c = std::move(heap[i]);
+
+		for (; i > 0 && c.count < heap[(i - 1) / 2].count; i = (i - 1) / 2)
+		{
+			place(i, std::move(heap[(i - 1) / 2]));
+		}
+
+		place(i, std::move(c));
+	}
+
+	void sift_down(size_t i)
+	{
+		Candidate c = std::move(heap[i]);
+
+		for (size_t child; (child = 2 * i + 1) < heap.size(); i = child)
+		{
+			if (child + 1 < heap.size() && heap[child + 1].count < heap[child].count)
+			{
+				++child;
+			}
+			if (!(heap[child].count < c.count)) break;
+			place(i, std::move(heap[child]));
+		}
+
+		place(i, std::move(c));
+	}
+};
+
+#endif
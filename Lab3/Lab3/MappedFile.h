@@ -0,0 +1,117 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// MappedFile class
+//
+// Read-only memory mapping of a whole file.
+//
+// CONSTRUCTION: with the name of the file to map
+//
+// ******************PUBLIC OPERATIONS*********************
+// bool isOpen( )         --> Return true if the file is mapped
+// const char* data( )    --> Return the first byte of the file
+// size_t size( )         --> Return the size of the file in bytes
+// ******************ERRORS********************************
+// isOpen( ) returns false if the file cannot be opened or mapped.
+// An empty file is open, with data( ) == nullptr and size( ) == 0.
+
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string & fileName)
+	{
+#ifdef _WIN32
+		file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) return;
+		length = static_cast<size_t>(fileSize.QuadPart);
+		open = true;
+		if (length == 0) return;
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) { open = false; return; }
+
+		base = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (base == nullptr) open = false;
+#else
+		fd = ::open(fileName.c_str(), O_RDONLY);
+		if (fd < 0) return;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0) return;
+		length = static_cast<size_t>(info.st_size);
+		open = true;
+		if (length == 0) return;
+
+		void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) { open = false; return; }
+
+		base = static_cast<const char*>(p);
+		madvise(p, length, MADV_SEQUENTIAL);
+#endif
+	}
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (base != nullptr) UnmapViewOfFile(base);
+		if (mapping != nullptr) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (base != nullptr) munmap(const_cast<char*>(base), length);
+		if (fd >= 0) ::close(fd);
+#endif
+	}
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	bool isOpen() const
+	{
+		return open;
+	}
+
+	const char* data() const
+	{
+		return base;
+	}
+
+	size_t size() const
+	{
+		return open ? length : 0;
+	}
+
+private:
+	const char *base = nullptr;
+	size_t length = 0;
+	bool open = false;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+};
+
+#endif
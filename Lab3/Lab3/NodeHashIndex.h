@@ -0,0 +1,154 @@
+#ifndef NODE_HASH_INDEX_H
+#define NODE_HASH_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <cstddef>
+using namespace std;
+
+// NodeHashIndex class template
+//
+// Hash index from items to the tree nodes that store them, kept next to a
+// search tree to answer exact-match lookups in O(1) expected time. Entries
+// are keyed by the hash value only, so no item is copied; an item is found
+// by comparing it with the nodes of equal hash using the tree's Compare.
+// Hash must agree with Compare: equivalent items must hash equally.
+// With Hash = void the index is empty and every operation does nothing.
+//
+// ******************PUBLIC OPERATIONS*********************
+// void insert( t )       --> Add node t
+// void erase( t )        --> Remove node t
+// void erase_subtree( t ) --> Remove t and all nodes below it
+// void rebuild( root )   --> Index exactly the nodes of the tree at root
+// void clear( )          --> Remove all nodes
+// bool find( x, comp, t ) --> Set t to the node storing x, or nullptr;
+//                            return false if Hash cannot hash x, in
+//                            which case the tree must be searched
+// size_t memoryBytes( )  --> Estimate the heap memory of the index: the
+//                            bucket array and one list node per entry,
+//                            without allocator overhead
+
+template <typename Node, typename Hash>
+class NodeHashIndex
+{
+public:
+	void insert(Node *t)
+	{
+		nodes.emplace(hash(t->element), t);
+	}
+
+	void erase(Node *t)
+	{
+		auto r = nodes.equal_range(hash(t->element));
+
+		for (auto i = r.first; i != r.second; ++i)
+		{
+			if (i->second == t)
+			{
+				nodes.erase(i);
+				return;
+			}
+		}
+	}
+
+	void erase_subtree(Node *t)
+	{
+		for_each_node(t, [this](Node *n) { erase(n); });
+	}
+
+	void rebuild(Node *root)
+	{
+		nodes.clear();
+		for_each_node(root, [this](Node *n) { insert(n); });
+	}
+
+	void clear()
+	{
+		nodes.clear();
+	}
+
+	template <typename K, typename Compare>
+	bool find(const K & x, const Compare & comp, Node* & t) const
+	{
+		return find(x, comp, t, 0);
+	}
+
+	size_t memoryBytes() const
+	{
+		// an entry is a (hash, node) pair in a singly linked list node
+		using Entry = pair<const size_t, Node*>;
+		return nodes.bucket_count() * sizeof(void*) + nodes.size() * (sizeof(Entry) + sizeof(void*));
+	}
+
+private:
+	Hash hash;
+	unordered_multimap<size_t, Node*> nodes;
+
+	// Chosen when hash(x) is well-formed
+	template <typename K, typename Compare>
+	auto find(const K & x, const Compare & comp, Node* & t, int) const
+		-> decltype(hash(x), true)
+	{
+		auto r = nodes.equal_range(hash(x));
+		t = nullptr;
+
+		for (auto i = r.first; i != r.second; ++i)
+		{
+			const auto & e = i->second->element;
+			if (!comp(x, e) && !comp(e, x))
+			{
+				t = i->second;
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	template <typename K, typename Compare>
+	bool find(const K &, const Compare &, Node* &, long) const
+	{
+		return false;
+	}
+
+	template <typename F>
+	static void for_each_node(Node *t, F f)
+	{
+		vector<Node*> pending;
+		if (t != nullptr) pending.push_back(t);
+
+		while (!pending.empty())
+		{
+			Node *n = pending.back();
+			pending.pop_back();
+			if (n->left != nullptr) pending.push_back(n->left);
+			if (n->right != nullptr) pending.push_back(n->right);
+			f(n);
+		}
+	}
+};
+
+template <typename Node>
+class NodeHashIndex<Node, void>
+{
+public:
+	void insert(Node *) { }
+	void erase(Node *) { }
+	void erase_subtree(Node *) { }
+	void rebuild(Node *) { }
+	void clear() { }
+
+	template <typename K, typename Compare>
+	bool find(const K &, const Compare &, Node* &) const
+	{
+		return false;
+	}
+
+	size_t memoryBytes() const
+	{
+		return 0;
+	}
+};
+
+#endif
@@ -0,0 +1,1161 @@
+#ifndef RADIX_TREE_H
+#define RADIX_TREE_H
+
+#include "dsexceptions.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RADIX_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+// RadixTree class
+//
+// CONSTRUCTION: zero parameter, or a range [first, last) of strings
+//
+// An ordered set of strings stored as an adaptive radix tree (ART). Each
+// node branches on one byte of the key, so a lookup inspects every byte of
+// the key once instead of comparing whole strings at every level as a
+// BinarySearchTree<string> does. Chains of single-child nodes are
+// compressed into a prefix stored in the node, and each node uses the
+// smallest of five layouts that holds its children: a leaf, 4 or 16
+// sorted bytes, a 256-byte index into 48 slots, or 256 direct slots.
+// Keys are ordered bytewise, as unsigned char, like std::string.
+//
+// ******************PUBLIC OPERATIONS*********************
+// bool insert( x )       --> Insert x; return false for duplicates
+// bool remove( x )       --> Remove x; return false if x is not found
+// BiIterator contains( x )    --> Return iterator to x, or end( )
+// BiIterator lower_bound( x ) --> Return iterator to first key not less than x
+// Range prefix_range( p )     --> Return the keys that start with p, in sorted order
+// void find_pred_succ( x, pred, suc ) --> As for BinarySearchTree
+// string findMin( )      --> Return smallest key
+// string findMax( )      --> Return largest key
+// size_t size( )         --> Return number of keys
+// boolean isEmpty( )     --> Return true if empty; else false
+// void makeEmpty( )      --> Remove all keys
+// void printTree( )      --> Print the keys in sorted order
+// ******************ITERATORS*****************************
+// A BiIterator holds a copy of its key. insert and remove may replace
+// nodes by larger or smaller ones, which invalidates all iterators.
+// ******************ERRORS********************************
+// Throws UnderflowException as warranted
+
+class RadixTree
+{
+	enum Kind : unsigned char { Leaf, Node4, Node16, Node48, Node256 };
+
+	// Common header of all node layouts
+	struct Node
+	{
+		Kind kind;
+		unsigned char edge;     // byte on the edge from the parent
+		bool terminal;          // a key ends at this node
+		uint16_t count = 0;     // number of children
+		Node *parent;
+		string prefix;          // bytes after edge, up to this node
+
+		Node(Kind k, unsigned char e, bool term, Node *p, string pre)
+			: kind{ k }, edge{ e }, terminal{ term }, parent{ p }, prefix{ std::move(pre) } { }
+	};
+
+	// Node4 and Node16: children sorted by byte
+	template <int N>
+	struct SortedNode : Node
+	{
+		unsigned char keys[N];
+		Node *child[N];
+
+		using Node::Node;
+	};
+
+	struct IndexedNode : Node
+	{
+		unsigned char index[256] = { };   // slot + 1 of the child for each byte, or 0
+		Node *child[48] = { };
+
+		using Node::Node;
+	};
+
+	struct DirectNode : Node
+	{
+		Node *child[256] = { };
+
+		using Node::Node;
+	};
+
+public:
+
+	class BiIterator
+	{
+	public:
+		BiIterator() : current{ nullptr } { }
+
+		const string & operator*() const
+		{
+			return key;
+		}
+
+		const string* operator->() const
+		{
+			return &key;
+		}
+
+		bool operator==(const BiIterator &it) const
+		{
+			return current == it.current;
+		}
+		bool operator!=(const BiIterator &it) const
+		{
+			return current != it.current;
+		}
+
+		BiIterator& operator++()
+		{
+			current = find_successor(current, key);
+			return *this;
+		}
+
+		BiIterator operator++(int)
+		{
+			BiIterator old = *this;
+			++*this;
+			return old;
+		}
+
+		BiIterator& operator--()
+		{
+			current = find_predecessor(current, key);
+			return *this;
+		}
+
+		BiIterator operator--(int)
+		{
+			BiIterator old = *this;
+			--*this;
+			return old;
+		}
+	private:
+		friend class RadixTree;
+
+		BiIterator(Node *t, string k) : current{ t }, key{ std::move(k) }
+		{
+			if (current == nullptr) key.clear();
+		}
+
+		Node *current;
+		string key;
+	};
+
+	/**
+	 * Half-open iterator range, usable in a range-based for loop.
+	 */
+	class Range
+	{
+	public:
+		Range(BiIterator b, BiIterator e) : first{ std::move(b) }, last{ std::move(e) } { }
+
+		BiIterator begin() const
+		{
+			return first;
+		}
+		BiIterator end() const
+		{
+			return last;
+		}
+	private:
+		BiIterator first;
+		BiIterator last;
+	};
+
+	BiIterator begin() const
+	{
+		if (isEmpty()) return end();
+		string key = root->prefix;
+		Node *t = descend_min(root, key);
+		return BiIterator(t, std::move(key));
+	}
+	BiIterator end() const
+	{
+		return BiIterator();
+	}
+
+	RadixTree() : root{ nullptr }
+	{
+	}
+
+	/**
+	 * Copy constructor
+	 */
+	RadixTree(const RadixTree & rhs) : root{ nullptr }, theSize{ rhs.theSize }
+	{
+		root = clone(rhs.root);
+	}
+
+	/**
+	 * Range constructor: insert the strings in [first, last).
+	 */
+	template <typename InputIterator>
+	RadixTree(InputIterator first, InputIterator last) : root{ nullptr }
+	{
+		for (; first != last; ++first)
+		{
+			insert(*first);
+		}
+	}
+
+	/**
+	 * Move constructor
+	 */
+	RadixTree(RadixTree && rhs) : root{ rhs.root }, theSize{ rhs.theSize }
+	{
+		rhs.root = nullptr;
+		rhs.theSize = 0;
+	}
+
+	/**
+	 * Destructor for the tree
+	 */
+	~RadixTree()
+	{
+		makeEmpty();
+	}
+
+	/**
+	 * Copy assignment: copy and swap idiom
+	 */
+	RadixTree & operator=(RadixTree _copy)
+	{
+		std::swap(root, _copy.root);
+		std::swap(theSize, _copy.theSize);
+		return *this;
+	}
+
+	/**
+	 * Find the smallest key in the tree.
+	 * Throw UnderflowException if empty.
+	 */
+	string findMin() const
+	{
+		if (isEmpty())
+		{
+			throw UnderflowException{ };
+		}
+
+		return *begin();
+	}
+
+	/**
+	 * Find the largest key in the tree.
+	 * Throw UnderflowException if empty.
+	 */
+	string findMax() const
+	{
+		if (isEmpty())
+		{
+			throw UnderflowException{ };
+		}
+
+		string key = root->prefix;
+		descend_max(root, key);
+		return key;
+	}
+
+	/**
+	 * Return an iterator to x, or end( ) if x is not found.
+	 */
+	BiIterator contains(const string & x) const
+	{
+		Node *t = find(x);
+		return (t != nullptr) ? BiIterator(t, x) : end();
+	}
+
+	/**
+	 * Return an iterator to the first key not less than x, or end( ).
+	 * Costs O(length of x) plus the descent to the key found.
+	 */
+	BiIterator lower_bound(const string & x) const
+	{
+		Node *t = root;
+		size_t depth = 0;
+
+		while (t != nullptr)
+		{
+			size_t m = mismatch_at(t->prefix, x, depth);
+
+			if (m < t->prefix.size())
+			{
+				string key = key_of(t);
+
+				if (depth + m == x.size() || byte(t->prefix[m]) > byte(x[depth + m]))
+				{
+					Node *first = descend_min(t, key);  // all of t is greater than x
+					return BiIterator(first, std::move(key));
+				}
+
+				Node *next = next_after_subtree(t, key); // all of t is less than x
+				return BiIterator(next, std::move(key));
+			}
+
+			depth += m;
+			if (depth == x.size())
+			{
+				string key = x;
+				Node *first = descend_min(t, key);  // t itself if x is a key
+				return BiIterator(first, std::move(key));
+			}
+
+			unsigned char b = byte(x[depth]);
+			Node **slot = find_child(t, b);
+
+			if (slot == nullptr)
+			{
+				string key = x.substr(0, depth);
+				Node *c = next_child(t, b);
+
+				if (c != nullptr)
+				{
+					append_edge(key, c);
+					Node *first = descend_min(c, key);
+					return BiIterator(first, std::move(key));
+				}
+
+				Node *next = next_after_subtree(t, key);
+				return BiIterator(next, std::move(key));
+			}
+
+			t = *slot;
+			++depth;
+		}
+
+		return end();
+	}
+
+	/**
+	 * Return the keys that start with p, in sorted order. They form one
+	 * subtree, found in O(length of p).
+	 */
+	Range prefix_range(const string & p) const
+	{
+		Node *t = root;
+		size_t depth = 0;
+
+		while (t != nullptr)
+		{
+			size_t m = mismatch_at(t->prefix, p, depth);
+
+			if (depth + m == p.size()) // all keys below t start with p
+			{
+				string key = key_of(t);
+				string lastKey = key;
+				Node *first = descend_min(t, key);
+				Node *last = next_after_subtree(t, lastKey);
+				return Range(BiIterator(first, std::move(key)), BiIterator(last, std::move(lastKey)));
+			}
+
+			if (m < t->prefix.size())
+			{
+				break;
+			}
+
+			depth += m;
+			Node **slot = find_child(t, byte(p[depth]));
+			if (slot == nullptr) break;
+			t = *slot;
+			++depth;
+		}
+
+		return Range(end(), end());
+	}
+
+	/**
+	 * Find the keys just before and after x, with the same results as
+	 * BinarySearchTree::find_pred_succ, but without modifying the tree.
+	 */
+	void find_pred_succ(const string & x, string & pred, string & suc) const
+	{
+		BiIterator it = lower_bound(x);
+		bool found = (it != end() && *it == x);
+
+		BiIterator before = it;
+		if (it == end())
+		{
+			if (!isEmpty())
+			{
+				string key = root->prefix;
+				Node *t = descend_max(root, key);
+				before = BiIterator(t, std::move(key));
+			}
+		}
+		else
+		{
+			--before;
+		}
+
+		if (found)
+		{
+			++it;
+			suc = (it != end()) ? *it : x;
+			pred = (before != end()) ? *before : x;
+		}
+		else
+		{
+			suc = (it != end()) ? *it : string{ };
+			pred = (before != end()) ? *before : string{ };
+		}
+	}
+
+	/**
+	 * Return the number of keys in the tree.
+	 */
+	size_t size() const
+	{
+		return theSize;
+	}
+
+	/**
+	 * Test if the tree is logically empty.
+	 * Return true if empty, false otherwise.
+	 */
+	bool isEmpty() const
+	{
+		return root == nullptr;
+	}
+
+	/**
+	 * Print the keys in sorted order, one per line.
+	 */
+	void printTree(ostream & out = cout) const
+	{
+		if (isEmpty())
+		{
+			out << "Empty tree" << endl;
+		}
+		else
+		{
+			for (BiIterator it = begin(); it != end(); ++it)
+			{
+				out << *it << endl;
+			}
+		}
+	}
+
+	/**
+	 * Make the tree logically empty.
+	 */
+	void makeEmpty()
+	{
+		destroy(root);
+		root = nullptr;
+		theSize = 0;
+	}
+
+	/**
+	 * Insert x into the tree; duplicates are ignored.
+	 * Return true if x was inserted.
+	 */
+	bool insert(const string & x)
+	{
+		if (root == nullptr)
+		{
+			root = new Node{ Leaf, 0, true, nullptr, x };
+			++theSize;
+			return true;
+		}
+
+		Node *t = root;
+		size_t depth = 0;
+
+		while (true)
+		{
+			size_t m = mismatch_at(t->prefix, x, depth);
+
+			if (m < t->prefix.size()) // x leaves the path inside the prefix of t
+			{
+				Node *split = new SortedNode<4>{ Node4, t->edge, false, t->parent, t->prefix.substr(0, m) };
+				*slot_of(t) = split;
+				t->edge = byte(t->prefix[m]);
+				t->prefix.erase(0, m + 1);
+				add_child(split, t->edge, t);
+
+				if (depth + m == x.size())
+				{
+					split->terminal = true;
+				}
+				else
+				{
+					unsigned char b = byte(x[depth + m]);
+					add_child(split, b, new Node{ Leaf, b, true, nullptr, x.substr(depth + m + 1) });
+				}
+
+				++theSize;
+				return true;
+			}
+
+			depth += m;
+			if (depth == x.size())
+			{
+				if (t->terminal) return false;  // Duplicate; do nothing
+				t->terminal = true;
+				++theSize;
+				return true;
+			}
+
+			unsigned char b = byte(x[depth]);
+			Node **slot = find_child(t, b);
+
+			if (slot == nullptr)
+			{
+				add_child(t, b, new Node{ Leaf, b, true, nullptr, x.substr(depth + 1) });
+				++theSize;
+				return true;
+			}
+
+			t = *slot;
+			++depth;
+		}
+	}
+
+	/**
+	 * Remove x from the tree.
+	 * Return false if x is not found.
+	 */
+	bool remove(const string & x)
+	{
+		Node *t = find(x);
+		if (t == nullptr) return false;
+
+		t->terminal = false;
+		--theSize;
+
+		// Restore the invariant that a node without a key has two children
+		if (t->count == 0)
+		{
+			Node *p = t->parent;
+			if (p == nullptr)
+			{
+				root = nullptr;
+				free_node(t);
+				return true;
+			}
+
+			p = remove_child(p, t->edge);
+			free_node(t);
+			t = p;
+		}
+
+		if (!t->terminal && t->count == 1)
+		{
+			merge_with_child(t);
+		}
+		else if (t->count == 0 && t->kind != Leaf)
+		{
+			resize(t, Leaf);
+		}
+
+		return true;
+	}
+
+private:
+	Node *root;
+	size_t theSize = 0;
+
+	static unsigned char byte(char c)
+	{
+		return static_cast<unsigned char>(c);
+	}
+
+	/**
+	 * Return the number of leading bytes of prefix that match x from depth on.
+	 */
+	static size_t mismatch_at(const string & prefix, const string & x, size_t depth)
+	{
+		size_t n = min(prefix.size(), x.size() - depth);
+		size_t m = 0;
+
+		while (m < n && prefix[m] == x[depth + m])
+		{
+			++m;
+		}
+
+		return m;
+	}
+
+	/**
+	 * Private member function to find the node where key x ends.
+	 * Return nullptr if x is not found.
+	 */
+	Node* find(const string & x) const
+	{
+		Node *t = root;
+		size_t depth = 0;
+
+		while (t != nullptr)
+		{
+			const string & p = t->prefix;
+			if (x.size() - depth < p.size() || x.compare(depth, p.size(), p) != 0)
+			{
+				return nullptr;
+			}
+
+			depth += p.size();
+			if (depth == x.size())
+			{
+				return t->terminal ? t : nullptr;
+			}
+
+			Node **slot = find_child(t, byte(x[depth]));
+			t = (slot != nullptr) ? *slot : nullptr;
+			++depth;
+		}
+
+		return nullptr;
+	}
+
+	static size_t capacity(Kind k)
+	{
+		switch (k)
+		{
+		case Leaf: return 0;
+		case Node4: return 4;
+		case Node16: return 16;
+		case Node48: return 48;
+		default: return 256;
+		}
+	}
+
+	/**
+	 * Return the slot of the child of t on byte b, or nullptr.
+	 */
+	static Node** find_child(Node *t, unsigned char b)
+	{
+		switch (t->kind)
+		{
+		case Leaf:
+			return nullptr;
+		case Node4:
+		{
+			auto n = static_cast<SortedNode<4>*>(t);
+			for (int i = 0; i < n->count; ++i)
+			{
+				if (n->keys[i] == b) return &n->child[i];
+			}
+			return nullptr;
+		}
+		case Node16:
+		{
+			auto n = static_cast<SortedNode<16>*>(t);
+#ifdef RADIX_SSE2
+			__m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys));
+			__m128i match = _mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(b)));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(match)) & ((1u << n->count) - 1);
+			if (mask == 0) return nullptr;
+			return &n->child[lowest_bit(mask)];
+#else
+			for (int i = 0; i < n->count; ++i)
+			{
+				if (n->keys[i] == b) return &n->child[i];
+			}
+			return nullptr;
+#endif
+		}
+		case Node48:
+		{
+			auto n = static_cast<IndexedNode*>(t);
+			return (n->index[b] != 0) ? &n->child[n->index[b] - 1] : nullptr;
+		}
+		default:
+		{
+			auto n = static_cast<DirectNode*>(t);
+			return (n->child[b] != nullptr) ? &n->child[b] : nullptr;
+		}
+		}
+	}
+
+#ifdef RADIX_SSE2
+	static unsigned lowest_bit(unsigned x)
+	{
+#ifdef _MSC_VER
+		unsigned long i;
+		_BitScanForward(&i, x);
+		return static_cast<unsigned>(i);
+#else
+		return static_cast<unsigned>(__builtin_ctz(x));
+#endif
+	}
+#endif
+
+	/**
+	 * Return the child of t with the smallest byte greater than b, or nullptr.
+	 * b = -1 gives the first child.
+	 */
+	static Node* next_child(Node *t, int b)
+	{
+		switch (t->kind)
+		{
+		case Leaf:
+			return nullptr;
+		case Node4:
+		case Node16:
+		{
+			const unsigned char *keys = sorted_keys(t);
+			Node * const *child = sorted_children(t);
+			for (int i = 0; i < t->count; ++i)
+			{
+				if (keys[i] > b) return child[i];
+			}
+			return nullptr;
+		}
+		case Node48:
+		{
+			auto n = static_cast<IndexedNode*>(t);
+			for (int i = b + 1; i < 256; ++i)
+			{
+				if (n->index[i] != 0) return n->child[n->index[i] - 1];
+			}
+			return nullptr;
+		}
+		default:
+		{
+			auto n = static_cast<DirectNode*>(t);
+			for (int i = b + 1; i < 256; ++i)
+			{
+				if (n->child[i] != nullptr) return n->child[i];
+			}
+			return nullptr;
+		}
+		}
+	}
+
+	/**
+	 * Return the child of t with the largest byte less than b, or nullptr.
+	 * b = 256 gives the last child.
+	 */
+	static Node* prev_child(Node *t, int b)
+	{
+		switch (t->kind)
+		{
+		case Leaf:
+			return nullptr;
+		case Node4:
+		case Node16:
+		{
+			const unsigned char *keys = sorted_keys(t);
+			Node * const *child = sorted_children(t);
+			for (int i = t->count - 1; i >= 0; --i)
+			{
+				if (keys[i] < b) return child[i];
+			}
+			return nullptr;
+		}
+		case Node48:
+		{
+			auto n = static_cast<IndexedNode*>(t);
+			for (int i = b - 1; i >= 0; --i)
+			{
+				if (n->index[i] != 0) return n->child[n->index[i] - 1];
+			}
+			return nullptr;
+		}
+		default:
+		{
+			auto n = static_cast<DirectNode*>(t);
+			for (int i = b - 1; i >= 0; --i)
+			{
+				if (n->child[i] != nullptr) return n->child[i];
+			}
+			return nullptr;
+		}
+		}
+	}
+
+	static unsigned char* sorted_keys(Node *t)
+	{
+		return (t->kind == Node4) ? static_cast<SortedNode<4>*>(t)->keys : static_cast<SortedNode<16>*>(t)->keys;
+	}
+
+	static Node** sorted_children(Node *t)
+	{
+		return (t->kind == Node4) ? static_cast<SortedNode<4>*>(t)->child : static_cast<SortedNode<16>*>(t)->child;
+	}
+
+	/**
+	 * Store child c on byte b in t, which must have room and no child on b.
+	 */
+	static void put_child(Node *t, unsigned char b, Node *c)
+	{
+		c->parent = t;
+		c->edge = b;
+
+		switch (t->kind)
+		{
+		case Node4:
+		case Node16:
+		{
+			unsigned char *keys = sorted_keys(t);
+			Node **child = sorted_children(t);
+			int i = t->count;
+			for (; i > 0 && keys[i - 1] > b; --i)
+			{
+				keys[i] = keys[i - 1];
+				child[i] = child[i - 1];
+			}
+			keys[i] = b;
+			child[i] = c;
+			break;
+		}
+		case Node48:
+		{
+			auto n = static_cast<IndexedNode*>(t);
+			int slot = 0;
+			while (n->child[slot] != nullptr) ++slot;
+			n->child[slot] = c;
+			n->index[b] = static_cast<unsigned char>(slot + 1);
+			break;
+		}
+		case Node256:
+			static_cast<DirectNode*>(t)->child[b] = c;
+			break;
+		default:
+			break;
+		}
+
+		++t->count;
+	}
+
+	/**
+	 * Private member function to add child c on byte b to t, moving t to
+	 * a larger layout first if it is full.
+	 */
+	void add_child(Node *t, unsigned char b, Node *c)
+	{
+		if (t->count == capacity(t->kind))
+		{
+			t = resize(t, static_cast<Kind>(t->kind + 1));
+		}
+
+		put_child(t, b, c);
+	}
+
+	/**
+	 * Private member function to remove the child on byte b from t, moving
+	 * t to a smaller layout once it is sparse enough.
+	 * Return t, or the node that replaced it.
+	 */
+	Node* remove_child(Node *t, unsigned char b)
+	{
+		switch (t->kind)
+		{
+		case Node4:
+		case Node16:
+		{
+			unsigned char *keys = sorted_keys(t);
+			Node **child = sorted_children(t);
+			int i = 0;
+			while (keys[i] != b) ++i;
+			for (; i + 1 < t->count; ++i)
+			{
+				keys[i] = keys[i + 1];
+				child[i] = child[i + 1];
+			}
+			break;
+		}
+		case Node48:
+		{
+			auto n = static_cast<IndexedNode*>(t);
+			n->child[n->index[b] - 1] = nullptr;
+			n->index[b] = 0;
+			break;
+		}
+		case Node256:
+			static_cast<DirectNode*>(t)->child[b] = nullptr;
+			break;
+		default:
+			break;
+		}
+
+		--t->count;
+
+		// Shrink with some slack, so alternating inserts and removes do not resize every time
+		if ((t->kind == Node256 && t->count <= 40) || (t->kind == Node48 && t->count <= 12) ||
+			(t->kind == Node16 && t->count <= 3))
+		{
+			t = resize(t, static_cast<Kind>(t->kind - 1));
+		}
+
+		return t;
+	}
+
+	/**
+	 * Private member function to replace t by a node of layout k with the
+	 * same prefix, key and children. t is deleted.
+	 * Return the new node.
+	 */
+	Node* resize(Node *t, Kind k)
+	{
+		Node *n = new_node(k, t->edge, t->terminal, t->parent, std::move(t->prefix));
+
+		for (Node *c = next_child(t, -1); c != nullptr; c = next_child(t, c->edge))
+		{
+			put_child(n, c->edge, c);
+		}
+
+		*slot_of(t) = n;
+		free_node(t);
+		return n;
+	}
+
+	/**
+	 * Private member function to replace t, which has no key and one
+	 * child, by that child, whose prefix then takes in the prefix of t.
+	 */
+	void merge_with_child(Node *t)
+	{
+		Node *c = next_child(t, -1);
+		string prefix = t->prefix;
+		prefix += static_cast<char>(c->edge);
+		prefix += c->prefix;
+		c->prefix = std::move(prefix);
+		c->edge = t->edge;
+		c->parent = t->parent;
+		*slot_of(t) = c;
+		free_node(t);
+	}
+
+	/**
+	 * Return the link (root or a child slot of the parent) that refers to t.
+	 */
+	Node** slot_of(Node *t)
+	{
+		return (t->parent == nullptr) ? &root : find_child(t->parent, t->edge);
+	}
+
+	static Node* new_node(Kind k, unsigned char edge, bool terminal, Node *parent, string prefix)
+	{
+		switch (k)
+		{
+		case Leaf: return new Node{ k, edge, terminal, parent, std::move(prefix) };
+		case Node4: return new SortedNode<4>{ k, edge, terminal, parent, std::move(prefix) };
+		case Node16: return new SortedNode<16>{ k, edge, terminal, parent, std::move(prefix) };
+		case Node48: return new IndexedNode{ k, edge, terminal, parent, std::move(prefix) };
+		default: return new DirectNode{ k, edge, terminal, parent, std::move(prefix) };
+		}
+	}
+
+	/**
+	 * Delete t as the layout it was allocated with.
+	 */
+	static void free_node(Node *t)
+	{
+		switch (t->kind)
+		{
+		case Leaf: delete t; break;
+		case Node4: delete static_cast<SortedNode<4>*>(t); break;
+		case Node16: delete static_cast<SortedNode<16>*>(t); break;
+		case Node48: delete static_cast<IndexedNode*>(t); break;
+		default: delete static_cast<DirectNode*>(t); break;
+		}
+	}
+
+	/**
+	 * Append the bytes on the way down to child c to key.
+	 */
+	static void append_edge(string & key, Node *c)
+	{
+		key += static_cast<char>(c->edge);
+		key += c->prefix;
+	}
+
+	/**
+	 * Remove the bytes on the way down to t from key.
+	 */
+	static void remove_edge(string & key, Node *t)
+	{
+		key.resize(key.size() - t->prefix.size() - (t->parent != nullptr ? 1 : 0));
+	}
+
+	/**
+	 * Return the full key of node t, whether or not t is terminal.
+	 */
+	static string key_of(Node *t)
+	{
+		vector<Node*> path;
+		for (; t != nullptr; t = t->parent)
+		{
+			path.push_back(t);
+		}
+
+		string key = path.back()->prefix;
+		for (auto i = path.rbegin() + 1; i != path.rend(); ++i)
+		{
+			append_edge(key, *i);
+		}
+
+		return key;
+	}
+
+	/**
+	 * Return the smallest key in subtree t, whose key is in key.
+	 * key is extended to the key found. A node without a key always has
+	 * children, so the descent ends at a key.
+	 */
+	static Node* descend_min(Node *t, string & key)
+	{
+		while (!t->terminal)
+		{
+			t = next_child(t, -1);
+			append_edge(key, t);
+		}
+
+		return t;
+	}
+
+	/**
+	 * Return the largest key in subtree t, whose key is in key.
+	 * key is extended to the key found.
+	 */
+	static Node* descend_max(Node *t, string & key)
+	{
+		while (t->count > 0)
+		{
+			t = prev_child(t, 256);
+			append_edge(key, t);
+		}
+
+		return t;
+	}
+
+	/**
+	 * Return the smallest key greater than all keys in subtree t, or
+	 * nullptr. key holds the key of t, and is changed to the key found.
+	 */
+	static Node* next_after_subtree(Node *t, string & key)
+	{
+		while (t->parent != nullptr)
+		{
+			Node *p = t->parent;
+			remove_edge(key, t);
+
+			Node *c = next_child(p, t->edge);
+			if (c != nullptr)
+			{
+				append_edge(key, c);
+				return descend_min(c, key);
+			}
+
+			t = p;
+		}
+
+		return nullptr;
+	}
+
+	static Node* find_successor(Node *t, string & key)
+	{
+		if (t == nullptr) return nullptr;
+
+		if (t->count > 0) // the keys below t are greater than the key of t
+		{
+			Node *c = next_child(t, -1);
+			append_edge(key, c);
+			return descend_min(c, key);
+		}
+
+		return next_after_subtree(t, key);
+	}
+
+	static Node* find_predecessor(Node *t, string & key)
+	{
+		if (t == nullptr) return nullptr;
+
+		while (t->parent != nullptr)
+		{
+			Node *p = t->parent;
+			remove_edge(key, t);
+
+			Node *c = prev_child(p, t->edge);
+			if (c != nullptr)
+			{
+				append_edge(key, c);
+				return descend_max(c, key);
+			}
+			if (p->terminal) return p;  // p is a prefix of all keys below it
+
+			t = p;
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * Private member function to copy the tree rooted at t.
+	 * Return the root of the copy.
+	 */
+	static Node* clone(Node *t)
+	{
+		if (t == nullptr)
+		{
+			return nullptr;
+		}
+
+		Node *copy = new_node(t->kind, t->edge, t->terminal, nullptr, t->prefix);
+		vector<pair<Node*, Node*>> pending{ { t, copy } };  // source and its copy
+
+		try
+		{
+			while (!pending.empty())
+			{
+				Node *src = pending.back().first;
+				Node *dst = pending.back().second;
+				pending.pop_back();
+
+				for (Node *c = next_child(src, -1); c != nullptr; c = next_child(src, c->edge))
+				{
+					Node *cc = new_node(c->kind, c->edge, c->terminal, nullptr, c->prefix);
+					put_child(dst, c->edge, cc);
+					pending.push_back({ c, cc });
+				}
+			}
+		}
+		catch (...)
+		{
+			destroy(copy);
+			throw;
+		}
+
+		return copy;
+	}
+
+	/**
+	 * Private member function to delete all nodes of subtree t.
+	 */
+	static void destroy(Node *t)
+	{
+		vector<Node*> pending;
+		if (t != nullptr) pending.push_back(t);
+
+		while (!pending.empty())
+		{
+			Node *n = pending.back();
+			pending.pop_back();
+
+			for (Node *c = next_child(n, -1); c != nullptr; c = next_child(n, c->edge))
+			{
+				pending.push_back(c);
+			}
+			free_node(n);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,660 @@
+#ifndef STRING_BINARY_SEARCH_TREE_H
+#define STRING_BINARY_SEARCH_TREE_H
+
+#include "dsexceptions.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+using namespace std;
+
+// StringBinarySearchTree class
+//
+// CONSTRUCTION: zero parameter, or a range [first, last) of strings
+//
+// A binary search tree of strings, ordered as std::string orders them, for
+// what BinarySearchTree<string> does with two allocations per item. The
+// characters of all keys are appended to one shared arena, so each item
+// costs a single node allocation. Each node also caches the first 8 bytes
+// of its key as a big-endian integer: comparing two such integers orders
+// the keys by those bytes, so most comparisons on the way down never touch
+// the arena. The full keys are compared only when the first 8 bytes tie
+// and both keys are longer than 8 bytes.
+//
+// The arena is append-only: remove leaves the characters of the removed
+// key behind until compact( ) or makeEmpty( ).
+//
+// ******************PUBLIC OPERATIONS*********************
+// bool insert( x )       --> Insert x; return false for duplicates
+// bool remove( x )       --> Remove x; return false if x is not found
+// BiIterator contains( x )    --> Return iterator to x, or end( )
+// BiIterator lower_bound( x ) --> Return iterator to first key not less than x
+// string findMin( )      --> Return smallest key
+// string findMax( )      --> Return largest key
+// size_t size( )         --> Return number of keys
+// boolean isEmpty( )     --> Return true if empty; else false
+// void makeEmpty( )      --> Remove all keys
+// size_t arenaBytes( )   --> Return the bytes in the arena, including removed keys
+// void compact( )        --> Drop the removed keys from the arena
+// void printTree( )      --> Print tree in sorted order
+// ******************ITERATORS*****************************
+// *it returns a copy of the key; it.data( ) and it.length( ) give the
+// characters in place, valid until the next insert or compact.
+// ******************ERRORS********************************
+// Throws UnderflowException as warranted
+
+class StringBinarySearchTree
+{
+	struct BinaryNode
+	{
+		uint64_t prefix;   // first 8 bytes, big-endian, zero-padded
+		size_t offset;     // position of the key in the arena
+		size_t length;
+		BinaryNode *left;
+		BinaryNode *right;
+		BinaryNode *parent;
+	};
+
+	// A key to search for, with its prefix computed once
+	struct Probe
+	{
+		const char *data;
+		size_t length;
+		uint64_t prefix;
+
+		Probe(const char *d, size_t n) : data{ d }, length{ n }, prefix{ prefix_of(d, n) } { }
+	};
+
+public:
+
+	class BiIterator
+	{
+	public:
+		BiIterator(const StringBinarySearchTree *tree = nullptr, BinaryNode *p = nullptr) : owner{ tree }, current{ p } { }
+
+		string operator*() const
+		{
+			return string(data(), length());
+		}
+
+		const char* data() const
+		{
+			return owner->arena.data() + current->offset;
+		}
+
+		size_t length() const
+		{
+			return current->length;
+		}
+
+		bool operator==(const BiIterator &it) const
+		{
+			return current == it.current;
+		}
+		bool operator!=(const BiIterator &it) const
+		{
+			return current != it.current;
+		}
+
+		BiIterator& operator++()
+		{
+			current = find_successor(current);
+			return *this;
+		}
+
+		BiIterator operator++(int)
+		{
+			BiIterator old = *this;
+			++*this;
+			return old;
+		}
+
+		BiIterator& operator--()
+		{
+			current = find_predecessor(current);
+			return *this;
+		}
+
+		BiIterator operator--(int)
+		{
+			BiIterator old = *this;
+			--*this;
+			return old;
+		}
+	private:
+		const StringBinarySearchTree *owner;
+		BinaryNode *current;
+	};
+
+	BiIterator begin() const
+	{
+		if (isEmpty()) return end();
+		return BiIterator(this, findMin(root));
+	}
+	BiIterator end() const
+	{
+		return BiIterator();
+	}
+
+	StringBinarySearchTree() : root{ nullptr }
+	{
+	}
+
+	/**
+	 * Copy constructor; the copy gets a compacted arena.
+	 */
+	StringBinarySearchTree(const StringBinarySearchTree & rhs) : root{ nullptr }, theSize{ rhs.theSize }
+	{
+		root = clone(rhs, rhs.root);
+	}
+
+	/**
+	 * Range constructor: build a balanced tree from the strings in
+	 * [first, last). Duplicates are ignored.
+	 */
+	template <typename InputIterator>
+	StringBinarySearchTree(InputIterator first, InputIterator last) : root{ nullptr }
+	{
+		vector<string> items(first, last);
+		std::sort(items.begin(), items.end());
+		items.erase(std::unique(items.begin(), items.end()), items.end());
+
+		size_t bytes = 0;
+		for (auto & x : items)
+		{
+			bytes += x.size();
+		}
+		arena.reserve(bytes);
+
+		root = build_balanced(items, 0, items.size(), nullptr);
+		theSize = items.size();
+	}
+
+	/**
+	 * Move constructor
+	 */
+	StringBinarySearchTree(StringBinarySearchTree && rhs)
+		: root{ rhs.root }, theSize{ rhs.theSize }, arena{ std::move(rhs.arena) }
+	{
+		rhs.root = nullptr;
+		rhs.theSize = 0;
+		rhs.arena.clear();
+	}
+
+	/**
+	 * Destructor for the tree
+	 */
+	~StringBinarySearchTree()
+	{
+		makeEmpty();
+	}
+
+	/**
+	 * Copy assignment: copy and swap idiom
+	 */
+	StringBinarySearchTree & operator=(StringBinarySearchTree _copy)
+	{
+		std::swap(root, _copy.root);
+		std::swap(theSize, _copy.theSize);
+		std::swap(arena, _copy.arena);
+		return *this;
+	}
+
+	/**
+	 * Find the smallest key in the tree.
+	 * Throw UnderflowException if empty.
+	 */
+	string findMin() const
+	{
+		if (isEmpty())
+		{
+			throw UnderflowException{ };
+		}
+
+		return key_of(findMin(root));
+	}
+
+	/**
+	 * Find the largest key in the tree.
+	 * Throw UnderflowException if empty.
+	 */
+	string findMax() const
+	{
+		if (isEmpty())
+		{
+			throw UnderflowException{ };
+		}
+
+		return key_of(findMax(root));
+	}
+
+	/**
+	 * Return an iterator to x, or end( ) if x is not found.
+	 */
+	BiIterator contains(const string & x) const
+	{
+		Probe p{ x.data(), x.size() };
+		BinaryNode *t = root;
+
+		while (t != nullptr)
+		{
+			int c = compare(p, t);
+
+			if (c < 0)
+				t = t->left;
+			else if (c > 0)
+				t = t->right;
+			else
+				return BiIterator(this, t);    // Match
+		}
+
+		return end();   // No match
+	}
+
+	/**
+	 * Return an iterator to the first key not less than x, or end( ).
+	 */
+	BiIterator lower_bound(const string & x) const
+	{
+		Probe p{ x.data(), x.size() };
+		BinaryNode *t = root;
+		BinaryNode *result = nullptr;
+
+		while (t != nullptr)
+		{
+			if (compare(p, t) > 0)
+			{
+				t = t->right;
+			}
+			else
+			{
+				result = t;
+				t = t->left;
+			}
+		}
+
+		return BiIterator(this, result);
+	}
+
+	/**
+	 * Return the number of keys in the tree.
+	 */
+	size_t size() const
+	{
+		return theSize;
+	}
+
+	/**
+	 * Test if the tree is logically empty.
+	 * Return true if empty, false otherwise.
+	 */
+	bool isEmpty() const
+	{
+		return root == nullptr;
+	}
+
+	/**
+	 * Return the number of bytes in the arena, including those of
+	 * removed keys.
+	 */
+	size_t arenaBytes() const
+	{
+		return arena.size();
+	}
+
+	/**
+	 * Print the tree contents in sorted order.
+	 */
+	void printTree(ostream & out = cout) const
+	{
+		if (isEmpty())
+		{
+			out << "Empty tree" << endl;
+		}
+		else
+		{
+			for (BinaryNode *t = findMin(root); t != nullptr; t = find_successor(t))
+			{
+				out.write(arena.data() + t->offset, t->length);
+				out << endl;
+			}
+		}
+	}
+
+	/**
+	 * Make the tree logically empty and release the arena.
+	 */
+	void makeEmpty()
+	{
+		destroy(root);
+		root = nullptr;
+		theSize = 0;
+		vector<char>{ }.swap(arena);
+	}
+
+	/**
+	 * Insert x into the tree; duplicates are ignored.
+	 * Return true if x was inserted.
+	 */
+	bool insert(const string & x)
+	{
+		return insert(x.data(), x.size());
+	}
+
+	/**
+	 * Insert the n characters at s; duplicates are ignored.
+	 * Return true if they were inserted.
+	 */
+	bool insert(const char *s, size_t n)
+	{
+		Probe p{ s, n };
+		BinaryNode **link = &root;
+		BinaryNode *parent = nullptr;
+
+		while (*link != nullptr)
+		{
+			int c = compare(p, *link);
+			if (c == 0) return false;  // Duplicate; do nothing
+
+			parent = *link;
+			link = (c < 0) ? &parent->left : &parent->right;
+		}
+
+		*link = new_node(s, n, parent);
+		++theSize;
+		return true;
+	}
+
+	/**
+	 * Remove x from the tree. A node with two children is replaced by its
+	 * successor node, which is relinked into its place.
+	 * Return false if x is not found.
+	 */
+	bool remove(const string & x)
+	{
+		Probe p{ x.data(), x.size() };
+		BinaryNode **link = &root;
+
+		while (*link != nullptr)
+		{
+			int c = compare(p, *link);
+			if (c == 0) break;
+			link = (c < 0) ? &(*link)->left : &(*link)->right;
+		}
+
+		BinaryNode *t = *link;
+		if (t == nullptr) return false;  // Item not found
+
+		if (t->left != nullptr && t->right != nullptr) // Two children
+		{
+			BinaryNode *succ = findMin(t->right);
+
+			if (succ->parent != t)
+			{
+				succ->parent->left = succ->right;
+				if (succ->right != nullptr) succ->right->parent = succ->parent;
+				succ->right = t->right;
+				succ->right->parent = succ;
+			}
+
+			succ->left = t->left;
+			succ->left->parent = succ;
+			succ->parent = t->parent;
+			*link = succ;
+		}
+		else
+		{
+			BinaryNode *child = (t->left != nullptr) ? t->left : t->right;
+			*link = child;
+			if (child != nullptr) child->parent = t->parent;
+		}
+
+		delete t;
+		--theSize;
+		return true;
+	}
+
+	/**
+	 * Rewrite the arena with only the keys in the tree, in sorted order.
+	 */
+	void compact()
+	{
+		vector<char> fresh;
+		size_t live = 0;
+		for (BinaryNode *t = isEmpty() ? nullptr : findMin(root); t != nullptr; t = find_successor(t))
+		{
+			live += t->length;
+		}
+		fresh.reserve(live);
+
+		for (BinaryNode *t = isEmpty() ? nullptr : findMin(root); t != nullptr; t = find_successor(t))
+		{
+			size_t offset = fresh.size();
+			fresh.insert(fresh.end(), arena.begin() + t->offset, arena.begin() + t->offset + t->length);
+			t->offset = offset;
+		}
+
+		arena.swap(fresh);
+	}
+
+private:
+	BinaryNode *root;
+	size_t theSize = 0;
+	vector<char> arena;
+
+	/**
+	 * Return the first 8 bytes of s[0, n) as a big-endian integer,
+	 * padded with zero bytes, so integer order is the order of the bytes.
+	 */
+	static uint64_t prefix_of(const char *s, size_t n)
+	{
+		uint64_t v = 0;
+		size_t k = min<size_t>(n, 8);
+
+		for (size_t i = 0; i < k; ++i)
+		{
+			v |= static_cast<uint64_t>(static_cast<unsigned char>(s[i])) << (56 - 8 * i);
+		}
+
+		return v;
+	}
+
+	/**
+	 * Private member function to compare probe p with the key of node t.
+	 * Return a negative value, zero or a positive value as p is less than,
+	 * equal to or greater than the key, in std::string order.
+	 */
+	int compare(const Probe & p, const BinaryNode *t) const
+	{
+		if (p.prefix != t->prefix)
+		{
+			return (p.prefix < t->prefix) ? -1 : 1;
+		}
+
+		// The first min(length, 8) bytes are equal, and zero padding
+		// only hides differences beyond the shorter key
+		size_t common = min(p.length, t->length);
+		if (common > 8)
+		{
+			int c = memcmp(p.data + 8, arena.data() + t->offset + 8, common - 8);
+			if (c != 0) return c;
+		}
+
+		return (p.length < t->length) ? -1 : (p.length > t->length) ? 1 : 0;
+	}
+
+	string key_of(const BinaryNode *t) const
+	{
+		return string(arena.data() + t->offset, t->length);
+	}
+
+	static BinaryNode* findMin(BinaryNode *t)
+	{
+		while (t->left != nullptr)
+		{
+			t = t->left;
+		}
+
+		return t;
+	}
+
+	static BinaryNode* findMax(BinaryNode *t)
+	{
+		while (t->right != nullptr)
+		{
+			t = t->right;
+		}
+
+		return t;
+	}
+
+	static BinaryNode* find_successor(BinaryNode *t)
+	{
+		if (t == nullptr) return nullptr;
+		if (t->right != nullptr) return findMin(t->right);
+
+		while (t->parent != nullptr && t == t->parent->right)
+		{
+			t = t->parent;
+		}
+
+		return t->parent;
+	}
+
+	static BinaryNode* find_predecessor(BinaryNode *t)
+	{
+		if (t == nullptr) return nullptr;
+		if (t->left != nullptr) return findMax(t->left);
+
+		while (t->parent != nullptr && t == t->parent->left)
+		{
+			t = t->parent;
+		}
+
+		return t->parent;
+	}
+
+	/**
+	 * Private member function to build a perfectly balanced subtree from
+	 * the sorted, duplicate-free items[lo, hi), with parent p.
+	 * Return the root of the new subtree.
+	 */
+	BinaryNode* build_balanced(const vector<string> & items, size_t lo, size_t hi, BinaryNode *p)
+	{
+		if (lo >= hi)
+		{
+			return nullptr;
+		}
+
+		size_t mid = lo + (hi - lo) / 2;
+		BinaryNode *t = new_node(items[mid].data(), items[mid].size(), p);
+
+		try
+		{
+			t->left = build_balanced(items, lo, mid, t);
+			t->right = build_balanced(items, mid + 1, hi, t);
+		}
+		catch (...)
+		{
+			destroy(t);
+			throw;
+		}
+
+		return t;
+	}
+
+	/**
+	 * Private member function to copy the subtree t of tree rhs,
+	 * appending the keys to this tree's arena.
+	 * Return the root of the copy.
+	 */
+	BinaryNode* clone(const StringBinarySearchTree & rhs, BinaryNode *t)
+	{
+		BinaryNode *copy = nullptr;
+		vector<pair<BinaryNode*, BinaryNode*>> pending;  // source node and the copy of its parent
+		if (t != nullptr) pending.push_back({ t, nullptr });
+
+		try
+		{
+			while (!pending.empty())
+			{
+				BinaryNode *src = pending.back().first;
+				BinaryNode *parent = pending.back().second;
+				pending.pop_back();
+
+				BinaryNode *n = new_node(rhs.arena.data() + src->offset, src->length, parent);
+				if (parent == nullptr)
+					copy = n;
+				else if (src == src->parent->left)
+					parent->left = n;
+				else
+					parent->right = n;
+
+				if (src->right != nullptr) pending.push_back({ src->right, n });
+				if (src->left != nullptr) pending.push_back({ src->left, n });
+			}
+		}
+		catch (...)
+		{
+			destroy(copy);
+			throw;
+		}
+
+		return copy;
+	}
+
+	/**
+	 * Private member function to append s[0, n) to the arena and return a
+	 * new leaf node for it with parent p. s may point into the arena, for
+	 * a key read back through an iterator; since growing the arena moves
+	 * it, such a key is then copied by position instead of by pointer.
+	 */
+	BinaryNode* new_node(const char *s, size_t n, BinaryNode *p)
+	{
+		uint64_t prefix = prefix_of(s, n);
+		size_t offset = arena.size();
+		std::less<const char*> before;
+
+		if (n > 0 && !before(s, arena.data()) && before(s, arena.data() + arena.size()))
+		{
+			size_t from = s - arena.data();
+			arena.resize(offset + n);
+			memcpy(arena.data() + offset, arena.data() + from, n);
+		}
+		else
+		{
+			arena.insert(arena.end(), s, s + n);
+		}
+
+		return new BinaryNode{ prefix, offset, n, nullptr, nullptr, p };
+	}
+
+	/**
+	 * Private member function to delete all nodes of subtree t.
+	 * Left children are rotated up, so no recursion or stack is needed.
+	 */
+	static void destroy(BinaryNode *t)
+	{
+		while (t != nullptr)
+		{
+			if (t->left != nullptr)
+			{
+				BinaryNode *lt = t->left;
+				t->left = lt->right;
+				lt->right = t;
+				t = lt;
+			}
+			else
+			{
+				BinaryNode *rt = t->right;
+				delete t;
+				t = rt;
+			}
+		}
+	}
+};
+
+#endif
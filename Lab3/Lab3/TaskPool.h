@@ -0,0 +1,200 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <cstddef>
+using namespace std;
+
+// TaskPool class
+//
+// A fixed set of worker threads that run tasks forked by fork_join, so
+// forking costs a queue operation instead of a thread creation. The shared
+// pool has one worker less than the hardware threads, since the forking
+// thread works too; on one hardware thread, fork_join runs f and g in turn.
+//
+// fork_join(f, g) queues f and runs g on the calling thread. If no worker
+// has taken f when g is done, the caller runs f itself; otherwise it waits
+// for f to finish. A task thus only waits for tasks that are running, so
+// tasks may fork further tasks without deadlock.
+//
+// ******************PUBLIC OPERATIONS*********************
+// static TaskPool & shared( ) --> Return the pool used by all trees
+// size_t threads( )      --> Return the number of workers plus one
+// void fork_join( f, g ) --> Run f( ) and g( ), in parallel if a worker is free
+// void parallel_for( n, f ) --> Run f( i ) for each i in [0, n), splitting
+//                              the range with fork_join
+// ******************ERRORS********************************
+// An exception thrown by f or g is rethrown by fork_join, once f is done
+// if a worker had started it; f is not run if g throws before that
+
+class TaskPool
+{
+public:
+	explicit TaskPool(size_t workerCount)
+	{
+		for (size_t i = 0; i < workerCount; ++i)
+		{
+			workers.emplace_back([this]() { work(); });
+		}
+	}
+
+	~TaskPool()
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			stop = true;
+		}
+		wake.notify_all();
+
+		for (auto & w : workers) w.join();
+	}
+
+	TaskPool(const TaskPool &) = delete;
+	TaskPool & operator=(const TaskPool &) = delete;
+
+	static TaskPool & shared()
+	{
+		static TaskPool pool(std::max(1u, thread::hardware_concurrency()) - 1);
+		return pool;
+	}
+
+	size_t threads() const
+	{
+		return workers.size() + 1;
+	}
+
+	template <typename F, typename G>
+	void fork_join(F f, G g)
+	{
+		if (workers.empty())
+		{
+			f();
+			g();
+			return;
+		}
+
+		Task task;
+		task.run = [&f]() { f(); };
+		{
+			lock_guard<mutex> guard(lock);
+			queue.push_back(&task);
+		}
+		wake.notify_one();
+
+		exception_ptr error;
+		try
+		{
+			g();
+		}
+		catch (...)
+		{
+			error = current_exception();
+		}
+
+		if (take_back(&task))
+		{
+			if (error) rethrow_exception(error);
+			f();
+			return;
+		}
+
+		unique_lock<mutex> guard(lock);
+		finished.wait(guard, [&task]() { return task.done; });
+		guard.unlock();
+
+		if (error) rethrow_exception(error);
+		if (task.error) rethrow_exception(task.error);
+	}
+
+	template <typename F>
+	void parallel_for(size_t n, F f)
+	{
+		for_range(0, n, f);
+	}
+
+private:
+	struct Task
+	{
+		function<void()> run;
+		exception_ptr error;
+		bool done = false;
+	};
+
+	vector<thread> workers;
+	deque<Task*> queue;
+	mutex lock;
+	condition_variable wake;      // a task was queued, or the pool stops
+	condition_variable finished;  // a task taken by a worker is done
+	bool stop = false;
+
+	/**
+	 * Remove task from the queue if no worker has taken it yet.
+	 * Return true if it was removed.
+	 */
+	bool take_back(Task *task)
+	{
+		lock_guard<mutex> guard(lock);
+		auto i = std::find(queue.rbegin(), queue.rend(), task);
+		if (i == queue.rend()) return false;
+
+		queue.erase(std::next(i).base());
+		return true;
+	}
+
+	/**
+	 * Run f( i ) for i in [lo, hi), forking the upper half at each split.
+	 */
+	template <typename F>
+	void for_range(size_t lo, size_t hi, F & f)
+	{
+		if (hi - lo > 1)
+		{
+			size_t mid = lo + (hi - lo) / 2;
+			fork_join([&]() { for_range(mid, hi, f); }, [&]() { for_range(lo, mid, f); });
+		}
+		else if (lo < hi)
+		{
+			f(lo);
+		}
+	}
+
+	/**
+	 * Worker loop: run the oldest queued task until the pool stops.
+	 */
+	void work()
+	{
+		unique_lock<mutex> guard(lock);
+
+		while (true)
+		{
+			wake.wait(guard, [this]() { return stop || !queue.empty(); });
+			if (stop) return;
+
+			Task *task = queue.front();
+			queue.pop_front();
+			guard.unlock();
+
+			try
+			{
+				task->run();
+			}
+			catch (...)
+			{
+				task->error = current_exception();
+			}
+
+			guard.lock();
+			task->done = true;
+			finished.notify_all();
+		}
+	}
+};
+
+#endif
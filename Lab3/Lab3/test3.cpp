@@ -24,8 +24,7 @@ int main()
 	vector<string> V1 = { istream_iterator<string>{file}, istream_iterator<string>{} };
 	file.close();
 
-	for (auto j : V1)
-		T.insert(j);
+	T.assign(V1.begin(), V1.end());
 
 	/**************************************/
 	cout << "\nPHASE 1: contains\n\n";
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <vector>
+
+#include "BinarySearchTree.h"
+
+using namespace std;
+
+
+
+//Test program 4: set operations on degenerate trees
+int main()
+{
+	const int N = 300000;
+
+	BinarySearchTree<int> chain;
+	BinarySearchTree<int> evens;
+
+	// Sorted, hinted inserts build a right chain of height N
+	auto last = chain.end();
+	for (int i = 0; i < N; i++)
+		last = chain.insert(last, i);
+
+	last = evens.end();
+	for (int i = 0; i < 2 * N; i += 2)
+		last = evens.insert(last, i);
+
+	cout << "Chain height = " << chain.stats().height << endl;
+
+	/**************************************/
+	cout << "\nPHASE 1: union_with\n\n";
+	/**************************************/
+
+	BinarySearchTree<int> U = chain;
+	U.union_with(evens);
+
+	int count = 0;
+	for (auto it = U.begin(); it != U.end(); ++it)
+		count++;
+
+	cout << "Items = " << count << " (expected " << N + N / 2 << ")" << endl;
+	cout << "Min = " << U.findMin() << ", Max = " << U.findMax() << endl;
+
+	/**************************************/
+	cout << "\nPHASE 2: intersect_with\n\n";
+	/**************************************/
+
+	BinarySearchTree<int> I = chain;
+	I.intersect_with(evens);
+
+	count = 0;
+	bool ok = true;
+	for (auto it = I.begin(); it != I.end(); ++it, count++)
+		ok = ok && *it == 2 * count;
+
+	cout << "Items = " << count << " (expected " << N / 2 << ")"
+		<< (ok ? ", all even" : ", WRONG ITEMS") << endl;
+
+	/**************************************/
+	cout << "\nPHASE 3: difference_with\n\n";
+	/**************************************/
+
+	BinarySearchTree<int> D = chain;
+	D.difference_with(evens);
+
+	count = 0;
+	ok = true;
+	for (auto it = D.begin(); it != D.end(); ++it, count++)
+		ok = ok && *it == 2 * count + 1;
+
+	cout << "Items = " << count << " (expected " << N / 2 << ")"
+		<< (ok ? ", all odd" : ", WRONG ITEMS") << endl;
+
+	cout << "\nFinished testing" << endl;
+
+	return 0;
+}
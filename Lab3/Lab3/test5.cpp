@@ -0,0 +1,78 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <utility>
+
+#include "BinarySearchTree.h"
+
+using namespace std;
+
+
+// Insert keys in order, each with the previous result as hint,
+// and print the time taken
+void hinted_inserts(const vector<int> & keys)
+{
+	BinarySearchTree<int> T;
+	auto last = T.end();
+
+	auto start = chrono::steady_clock::now();
+
+	for (int x : keys)
+		last = T.insert(last, x);
+
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	int count = 0;
+	bool ok = true;
+	for (auto it = T.begin(); it != T.end(); ++it, count++)
+		ok = ok && *it == count;
+
+	cout << "Items = " << count << (ok ? "" : ", WRONG ITEMS")
+		<< ", height = " << T.stats().height << endl;
+	cout << "Time = " << elapsed.count() << " s" << endl;
+}
+
+
+//Test program 5: hinted inserts of nearly sorted keys
+int main()
+{
+	const int N = 100000;
+
+	vector<int> keys(N);
+	for (int i = 0; i < N; i++)
+		keys[i] = i;
+
+	/**************************************/
+	cout << "\nPHASE 1: sorted keys\n\n";
+	/**************************************/
+
+	hinted_inserts(keys);
+
+	/**************************************/
+	cout << "\nPHASE 2: 1% adjacent swaps\n\n";
+	/**************************************/
+
+	vector<int> swapped = keys;
+	mt19937 gen(4);
+	for (int i = 0; i + 1 < N; i++)
+		if (gen() % 100 == 0)
+			swap(swapped[i], swapped[i + 1]);
+
+	hinted_inserts(swapped);
+
+	/**************************************/
+	cout << "\nPHASE 3: one key far ahead of the rest\n\n";
+	/**************************************/
+
+	// The right chain 0..9 with N-1 on top, then 10..N-2 between them
+	vector<int> outlier = keys;
+	outlier.erase(outlier.end() - 1);
+	outlier.insert(outlier.begin() + 10, N - 1);
+
+	hinted_inserts(outlier);
+
+	cout << "\nFinished testing" << endl;
+
+	return 0;
+}
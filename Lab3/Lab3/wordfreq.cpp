@@ -0,0 +1,337 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WORDFREQ_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "BinarySearchTree.h"
+#include "MappedFile.h"
+#include "HeavyHitters.h"
+
+using namespace std;
+
+// Word frequency table for large files (C++17)
+//
+// usage: wordfreq [input [output [threads]]]
+//        wordfreq --top k [--epsilon e] [--delta d] [input [output]]
+//
+// The input (default words.txt) is memory-mapped and split into one chunk
+// per thread at word boundaries. Words are separated by white space, as for
+// istream_iterator<string>. Each thread counts the words of its chunk in its
+// own BinarySearchTree, probing its hash index with string_views into the
+// mapped file, so lookups are O(1) and only new words allocate. The sorted
+// per-thread trees are then merged into one table in the format of
+// frequency_table.txt.
+//
+// With --top, only the approximately k most frequent words are kept, in a
+// HeavyHitters sketch whose memory does not depend on the input size. They
+// are printed most frequent first, in the same format. Counts may be too
+// high, by at most e times the number of words (default e = 0.0001) with
+// probability 1 - d (default d = 0.01). An input of - reads the words from
+// standard input as a stream.
+
+struct WordCount
+{
+	string word;
+	size_t count;
+};
+
+// Orders WordCount by word; transparent, so trees can be probed with string_view
+struct WordLess
+{
+	using is_transparent = void;
+
+	bool operator()(const WordCount & a, const WordCount & b) const { return a.word < b.word; }
+	bool operator()(const WordCount & a, string_view b) const { return string_view{ a.word } < b; }
+	bool operator()(string_view a, const WordCount & b) const { return a < string_view{ b.word }; }
+};
+
+// Hashes WordCount by word, consistently with WordLess
+struct WordHash
+{
+	size_t operator()(const WordCount & a) const { return hash<string_view>{ }(a.word); }
+	size_t operator()(string_view a) const { return hash<string_view>{ }(a); }
+};
+
+using WordTree = BinarySearchTree<WordCount, WordLess, false, WordHash>;
+
+// White space as for isspace in the "C" locale: ' ', '\t', '\n', '\v', '\f', '\r'
+inline bool is_delimiter(char c)
+{
+	unsigned char u = static_cast<unsigned char>(c);
+	return u == ' ' || static_cast<unsigned char>(u - '\t') <= '\r' - '\t';
+}
+
+const size_t BLOCK = 16;
+
+// Bit i of the result is set if p[i] is a delimiter, for the BLOCK bytes at p
+inline uint32_t delimiter_mask(const char *p)
+{
+#ifdef WORDFREQ_SSE2
+	__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	__m128i space = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+	__m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+	__m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+	return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(space, control)));
+#else
+	uint32_t mask = 0;
+	for (size_t i = 0; i < BLOCK; ++i)
+	{
+		if (is_delimiter(p[i])) mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
+inline unsigned lowest_bit(uint32_t x)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward(&i, x);
+	return static_cast<unsigned>(i);
+#else
+	return static_cast<unsigned>(__builtin_ctz(x));
+#endif
+}
+
+void count_word(WordTree & T, string_view w)
+{
+	auto it = T.contains(w);
+
+	if (it != T.end())
+		++(*it).count;
+	else
+		T.insert(WordCount{ string{ w }, 1 });
+}
+
+// Call f(word) for each word in [first, last), scanning one BLOCK of delimiter bits at a time
+template <typename F>
+void for_each_word(const char *first, const char *last, F f)
+{
+	const uint32_t all = (1u << BLOCK) - 1;
+	const char *p = first;
+	const char *start = nullptr;  // start of the current word, if inside one
+
+	for (; last - p >= static_cast<ptrdiff_t>(BLOCK); p += BLOCK)
+	{
+		uint32_t delim = delimiter_mask(p);
+		unsigned i = 0;
+
+		while (i < BLOCK)
+		{
+			uint32_t rest = (start != nullptr ? delim : ~delim & all) >> i;
+			if (rest == 0) break;
+
+			i += lowest_bit(rest);
+			if (start != nullptr)
+			{
+				f(string_view(start, p + i - start));
+				start = nullptr;
+			}
+			else
+			{
+				start = p + i;
+			}
+		}
+	}
+
+	for (; p != last; ++p)
+	{
+		if (is_delimiter(*p))
+		{
+			if (start != nullptr) f(string_view(start, p - start));
+			start = nullptr;
+		}
+		else if (start == nullptr)
+		{
+			start = p;
+		}
+	}
+
+	if (start != nullptr) f(string_view(start, last - start));
+}
+
+// Count the words in [first, last) into T
+void count_words(const char *first, const char *last, WordTree & T)
+{
+	for_each_word(first, last, [&T](string_view w) { count_word(T, w); });
+}
+
+// Merge the sorted trees, adding up the counts of equal words
+void print_table(const vector<WordTree> & trees, ostream & out)
+{
+	vector<WordTree::BiIterator> heads;
+	for (const auto & T : trees)
+		heads.push_back(T.begin());
+
+	while (true)
+	{
+		const string *smallest = nullptr;
+		for (auto & it : heads)
+		{
+			if (it != WordTree::BiIterator() && (smallest == nullptr || (*it).word < *smallest))
+				smallest = &(*it).word;
+		}
+		if (smallest == nullptr) break;
+
+		string word = *smallest;
+		size_t count = 0;
+		for (auto & it : heads)
+		{
+			if (it != WordTree::BiIterator() && (*it).word == word)
+			{
+				count += (*it).count;
+				++it;
+			}
+		}
+
+		out << setw(15) << word << setw(6) << count << "\n";
+	}
+}
+
+void print_top(const HeavyHitters & H, ostream & out)
+{
+	for (const auto & wc : H.top())
+		out << setw(15) << wc.first << setw(6) << wc.second << "\n";
+}
+
+// Print the approximate top k words of inName, or of standard input for "-"
+int top_words(const string & inName, const char *outName, size_t k, double epsilon, double delta)
+{
+	HeavyHitters H(k, epsilon, delta);
+
+	if (inName == "-")
+	{
+		string w;
+		while (cin >> w)
+			H.add(w);
+	}
+	else
+	{
+		MappedFile file(inName);
+		if (!file.isOpen())
+		{
+			cout << "couldn't open file " << inName << endl;
+			return 1;
+		}
+		for_each_word(file.data(), file.data() + file.size(), [&H](string_view w) { H.add(w.data(), w.size()); });
+	}
+
+	if (outName != nullptr)
+	{
+		ofstream out(outName);
+		if (!out)
+		{
+			cout << "couldn't open file " << outName << endl;
+			return 1;
+		}
+		print_top(H, out);
+	}
+	else
+	{
+		print_top(H, cout);
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t topK = 0;
+	double epsilon = 1e-4;
+	double delta = 0.01;
+	vector<char*> args{ argv[0] };
+
+	for (int i = 1; i < argc; ++i)
+	{
+		string opt = argv[i];
+		if ((opt == "--top" || opt == "--epsilon" || opt == "--delta") && i + 1 < argc)
+		{
+			if (opt == "--top") topK = static_cast<size_t>(atol(argv[++i]));
+			else if (opt == "--epsilon") epsilon = atof(argv[++i]);
+			else delta = atof(argv[++i]);
+		}
+		else
+		{
+			args.push_back(argv[i]);
+		}
+	}
+	argc = static_cast<int>(args.size());
+	argv = args.data();
+
+	string inName = (argc > 1) ? argv[1] : "words.txt";
+
+	if (topK > 0)
+	{
+		if (!(epsilon > 0) || !(delta > 0 && delta < 1))
+		{
+			cout << "epsilon must be positive and delta in (0, 1)" << endl;
+			return 1;
+		}
+		return top_words(inName, (argc > 2) ? argv[2] : nullptr, topK, epsilon, delta);
+	}
+
+	unsigned threads = (argc > 3) ? static_cast<unsigned>(atoi(argv[3])) : thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+
+	MappedFile file(inName);
+
+	if (!file.isOpen())
+	{
+		cout << "couldn't open file " << inName << endl;
+		return 1;
+	}
+
+	const char *first = file.data();
+	const char *last = first + file.size();
+
+	// Chunk boundaries, moved forward onto a delimiter so no word is split
+	vector<const char*> bounds{ first };
+	for (unsigned i = 1; i < threads; ++i)
+	{
+		const char *b = first + file.size() / threads * i;
+		if (b < bounds.back()) b = bounds.back();
+		while (b != last && !is_delimiter(*b)) ++b;
+		bounds.push_back(b);
+	}
+	bounds.push_back(last);
+
+	vector<WordTree> trees(threads);
+	vector<thread> workers;
+
+	for (unsigned i = 0; i < threads; ++i)
+		workers.emplace_back(count_words, bounds[i], bounds[i + 1], ref(trees[i]));
+
+	for (auto & w : workers)
+		w.join();
+
+	if (argc > 2)
+	{
+		ofstream out(argv[2]);
+		if (!out)
+		{
+			cout << "couldn't open file " << argv[2] << endl;
+			return 1;
+		}
+		print_table(trees, out);
+	}
+	else
+	{
+		print_table(trees, cout);
+	}
+
+	return 0;
+}
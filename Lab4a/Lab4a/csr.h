@@ -0,0 +1,134 @@
+/*********************************************
+* file:	~\tnd004\lab\lab4a\csr.h             *
+* remark: compressed sparse row adjacency    *
+**********************************************/
+
+#ifndef CSR_H
+#define CSR_H
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+#include "list.h"
+
+// The edges (v, w) of vertex v are stored at positions
+// begin(v) .. end(v)-1 of the contiguous arrays targets and weights,
+// in the same order as in the adjacency list of v.
+// Traversing all edges thus reads memory sequentially,
+// instead of following one heap allocated node per edge.
+
+class CSR
+{
+public:
+	// -- CONSTRUCTORS
+	CSR() : size(0), minW(0), maxW(0) { }
+
+	// -- MEMBER FUNCTIONS
+
+	// rebuild from the adjacency lists array[1..n]
+	void build(List *array, int n);
+
+	// rebuild as the reverse of G, with edge (v, u) for each edge (u, v);
+	// the edges of each vertex are in increasing order of vertex
+	void transpose(const CSR &G);
+
+	// first edge of vertex v
+	int begin(int v) const { return offsets[v]; }
+
+	// one past the last edge of vertex v
+	int end(int v) const { return offsets[v + 1]; }
+
+	// head vertex of edge e
+	int vertex(int e) const { return targets[e]; }
+
+	// weight of edge e
+	int weight(int e) const { return weights[e]; }
+
+	// number of vertices
+	int vertices() const { return size; }
+
+	// number of edges
+	int edges() const { return (int)targets.size(); }
+
+	// smallest and largest edge weight, 0 if there are no edges
+	int minWeight() const { return minW; }
+	int maxWeight() const { return maxW; }
+
+private:
+	// -- DATA MEMBERS
+	vector<int> offsets;   // offsets[1..size+1]
+	vector<int> targets;
+	vector<int> weights;
+	int size;
+	int minW;
+	int maxW;
+};
+
+// -- MEMBER FUNCTIONS
+
+// rebuild from the adjacency lists array[1..n]
+inline void CSR::build(List *array, int n)
+{
+	size = n;
+	offsets.assign(n + 2, 0);
+	targets.clear();
+	weights.clear();
+
+	for (int v = 1; v <= n; v++)
+	{
+		offsets[v] = (int)targets.size();
+
+		for (Node *p = array[v].getFirst(); p != nullptr; p = array[v].getNext())
+		{
+			targets.push_back(p->vertex);
+			weights.push_back(p->weight);
+		}
+	}
+
+	offsets[n + 1] = (int)targets.size();
+
+	minW = weights.empty() ? 0 : *min_element(weights.begin(), weights.end());
+	maxW = weights.empty() ? 0 : *max_element(weights.begin(), weights.end());
+}
+
+// rebuild as the reverse of G, with edge (v, u) for each edge (u, v);
+// the edges of each vertex are in increasing order of vertex
+inline void CSR::transpose(const CSR &G)
+{
+	int n = G.size;
+
+	size = n;
+	minW = G.minW;
+	maxW = G.maxW;
+	offsets.assign(n + 2, 0);
+	targets.resize(G.edges());
+	weights.resize(G.edges());
+
+	// count the edges into each vertex, then place them
+	for (int e = 0; e < G.edges(); e++)
+	{
+		offsets[G.targets[e] + 1]++;
+	}
+
+	offsets[1] = 0;
+	for (int v = 1; v <= n; v++)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+
+	vector<int> next(offsets.begin(), offsets.end() - 1);
+
+	for (int u = 1; u <= n; u++)
+	{
+		for (int e = G.begin(u); e < G.end(u); e++)
+		{
+			int i = next[G.targets[e]]++;
+			targets[i] = u;
+			weights[i] = G.weights[e];
+		}
+	}
+}
+
+#endif
@@ -8,11 +8,17 @@
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 
 using namespace std;
 
 #include "digraph.h"
 #include "queue.h"
+#include "indexheap.h"
+#include "parallel.h"
 
 const int INF = 9999;
 //const int INF = 9999; //Visual Studio seems to dislike the constant name "INFINITY"
@@ -20,6 +26,7 @@ const int INF = 9999;
 // -- CONSTRUCTORS
 
 Digraph::Digraph(int n)
+	: forward(n), backward(n)
 {
 	assert(n >= 1);
 	array = new List[n + 1];
@@ -27,6 +34,8 @@ Digraph::Digraph(int n)
 	path = new int[n + 1];
 	done = new bool[n + 1];
 	size = n;
+	dirty = true;
+	rdirty = true;
 }
 
 // -- DESTRUCTOR
@@ -48,6 +57,7 @@ void Digraph::insertEdge(int u, int v, int w)
 	assert(u >= 1 && u <= size);
 	assert(v >= 1 && v <= size);
 	array[u].insert(v, w);
+	dirty = true;
 }
 
 // remove directed edge (u, v)
@@ -56,10 +66,11 @@ void Digraph::removeEdge(int u, int v)
 	assert(u >= 1 && u <= size);
 	assert(v >= 1 && v <= size);
 	array[u].remove(v);
+	dirty = true;
 }
 
 // unweighted single source shortest paths
-void Digraph::uwsssp(int s)
+void Digraph::uwsssp(int s, int threads)
 {
 	if (s < 1 || s > size)
 	{
@@ -67,7 +78,7 @@ void Digraph::uwsssp(int s)
 		return;
 	}
 
-	Queue<int> Q;
+	const CSR &G = adjacency();
 
 	for (int i = 1; i <= size; i++)
 	{
@@ -75,6 +86,27 @@ void Digraph::uwsssp(int s)
 		path[i] = 0;
 	}
 
+	if (threads <= 0)
+	{
+		threads = (G.edges() >= ParallelLimit) ? hardwareThreads() : 1;
+	}
+
+	if (threads == 1)
+	{
+		bfsQueue(s);
+	}
+	else
+	{
+		bfsParallel(s, threads);
+	}
+}
+
+// breadth-first search with a FIFO queue
+void Digraph::bfsQueue(int s)
+{
+	const CSR &G = adjacency();
+	Queue<int> Q;
+
 	dist[s] = 0;
 	Q.enqueue(s);
 
@@ -83,24 +115,179 @@ void Digraph::uwsssp(int s)
 		int v = Q.getFront();
 		Q.dequeue();
 
-		Node *p = array[v].getFirst();
-
-		while (p != nullptr)
+		for (int e = G.begin(v); e < G.end(v); e++)
 		{
-			if (dist[p->vertex] == INF)
+			int u = G.vertex(e);
+
+			if (dist[u] == INF)
 			{
-				dist[p->vertex] = dist[v] + 1;
-				path[p->vertex] = v;
-				Q.enqueue(p->vertex);
+				dist[u] = dist[v] + 1;
+				path[u] = v;
+				Q.enqueue(u);
 			}
-			p = array[v].getNext();
 		}
 	}
 }
 
+// Direction-optimizing breadth-first search (Beamer et al.),
+// one level at a time, each level expanded by several threads.
+// Top-down: the edges out of the frontier are followed to unvisited vertices.
+// Bottom-up: every unvisited vertex looks for an edge into it from the frontier
+// and stops at the first one found, so a large frontier is cheap to expand.
+// Bottom-up starts when the edges out of the frontier exceed 1/Alpha of the
+// edges into unvisited vertices, and lasts while the frontier holds at least
+// 1/Beta of all vertices.
+//
+// dist equals that of bfsQueue, but path[u] is any frontier vertex with an
+// edge to u, so path may be another shortest path tree than that of bfsQueue.
+void Digraph::bfsParallel(int s, int threads)
+{
+	const int Alpha = 14;
+	const int Beta = 24;
+
+	const CSR &G = adjacency();
+	const CSR &R = reverseAdjacency();
+	int words = size / 64 + 1;
+
+	vector<atomic<uint64_t>> visited(words);
+	vector<atomic<uint64_t>> inFrontier(words);
+	vector<int> frontier(1, s);
+	vector<int> next;
+	vector<vector<int>> local(threads);       // vertices found by each thread
+	vector<long long> edgesOut(threads);      // edges out of them
+	vector<long long> edgesIn(threads);       // edges into them
+	vector<size_t> offset(threads + 1, 0);
+	ThreadPool pool(threads);
+
+	for (int w = 0; w < words; w++)
+	{
+		visited[w] = 0;
+		inFrontier[w] = 0;
+	}
+
+	dist[s] = 0;
+	visited[s / 64] = uint64_t(1) << (s % 64);
+
+	long long edgesToCheck = G.edges() - (R.end(s) - R.begin(s));   // edges into unvisited vertices
+	long long edgesFrontier = G.end(s) - G.begin(s);                // edges out of the frontier
+	bool bottomUp = false;
+
+	for (int level = 0; !frontier.empty(); level++)
+	{
+		int f = (int)frontier.size();
+
+		if (bottomUp)
+		{
+			bottomUp = (long long)f * Beta >= size;
+		}
+		else
+		{
+			bottomUp = edgesFrontier * Alpha > edgesToCheck;
+		}
+
+		if (bottomUp)
+		{
+			pool.run(f, [&](int, int lo, int hi) {
+				for (int i = lo; i < hi; i++)
+				{
+					int v = frontier[i];
+					inFrontier[v / 64].fetch_or(uint64_t(1) << (v % 64), memory_order_relaxed);
+				}
+			});
+
+			// each thread owns the vertices of whole words
+			pool.run(words, [&](int t, int lo, int hi) {
+				int last = (hi * 64 - 1 < size) ? hi * 64 - 1 : size;
+				long long out = 0, in = 0;
+
+				for (int u = (lo * 64 > 1) ? lo * 64 : 1; u <= last; u++)
+				{
+					uint64_t bit = uint64_t(1) << (u % 64);
+
+					if (visited[u / 64].load(memory_order_relaxed) & bit) continue;
+
+					for (int e = R.begin(u); e < R.end(u); e++)
+					{
+						int v = R.vertex(e);
+
+						if (inFrontier[v / 64].load(memory_order_relaxed) >> (v % 64) & 1)
+						{
+							visited[u / 64].fetch_or(bit, memory_order_relaxed);
+							dist[u] = level + 1;
+							path[u] = v;
+							local[t].push_back(u);
+							out += G.end(u) - G.begin(u);
+							in += R.end(u) - R.begin(u);
+							break;
+						}
+					}
+				}
+
+				edgesOut[t] = out;
+				edgesIn[t] = in;
+			});
+
+			pool.run(words, [&](int, int lo, int hi) {
+				for (int w = lo; w < hi; w++) inFrontier[w].store(0, memory_order_relaxed);
+			});
+		}
+		else
+		{
+			pool.run(f, [&](int t, int lo, int hi) {
+				long long out = 0, in = 0;
+
+				for (int i = lo; i < hi; i++)
+				{
+					int v = frontier[i];
+
+					for (int e = G.begin(v); e < G.end(v); e++)
+					{
+						int u = G.vertex(e);
+						uint64_t bit = uint64_t(1) << (u % 64);
+
+						// the thread that sets the visited bit of u owns u
+						if (visited[u / 64].load(memory_order_relaxed) & bit) continue;
+						if (visited[u / 64].fetch_or(bit, memory_order_relaxed) & bit) continue;
+
+						dist[u] = level + 1;
+						path[u] = v;
+						local[t].push_back(u);
+						out += G.end(u) - G.begin(u);
+						in += R.end(u) - R.begin(u);
+					}
+				}
+
+				edgesOut[t] = out;
+				edgesIn[t] = in;
+			});
+		}
+
+		// concatenate the vertices found by the threads into the next frontier
+		edgesFrontier = 0;
+		for (int t = 0; t < threads; t++)
+		{
+			offset[t + 1] = offset[t] + local[t].size();
+			edgesFrontier += edgesOut[t];
+			edgesToCheck -= edgesIn[t];
+			edgesOut[t] = edgesIn[t] = 0;
+		}
+
+		next.resize(offset[threads]);
+
+		pool.run(threads, [&](int, int lo, int hi) {
+			for (int t = lo; t < hi; t++)
+			{
+				copy(local[t].begin(), local[t].end(), next.begin() + offset[t]);
+				local[t].clear();
+			}
+		});
+
+		frontier.swap(next);
+	}
+}
+
 // positive weighted single source shortest paths
-//Dijktras algorithm
-void Digraph::pwsssp(int s)
+void Digraph::pwsssp(int s, Method m, int delta, int threads)
 {
 	if (s < 1 || s > size)
 	{
@@ -108,6 +295,8 @@ void Digraph::pwsssp(int s)
 		return;
 	}
 
+	const CSR &G = adjacency();
+
 	for (int i = 1; i <= size; i++)
 	{
 		dist[i] = INF;
@@ -115,22 +304,72 @@ void Digraph::pwsssp(int s)
 		done[i] = false;
 	}
 
+	if (threads <= 0)
+	{
+		threads = (G.edges() >= ParallelLimit) ? hardwareThreads() : 1;
+	}
+
+	// delta-stepping needs positive weights and pays off only in parallel
+	if (m == DELTA && (threads == 1 || G.minWeight() < 1))
+	{
+		m = AUTO;
+	}
+
+	// DELTA is not chosen, since it has not been measured to be faster;
+	// BUCKET only for positive weights, where path is the same as from SCAN
+	if (m == AUTO)
+	{
+		if (G.minWeight() >= 1 && G.maxWeight() <= BucketLimit)
+		{
+			m = BUCKET;
+		}
+		else
+		{
+			// the heap is slower only when most pairs of vertices are adjacent
+			m = (2LL * G.edges() >= (long long)size * size) ? SCAN : HEAP;
+		}
+	}
+
+	if (m == BUCKET && G.minWeight() < 0)
+	{
+		m = HEAP;
+	}
+
+	switch (m)
+	{
+	case SCAN:
+		dijkstraScan(s);
+		break;
+	case BUCKET:
+		dijkstraBuckets(s);
+		break;
+	case DELTA:
+		deltaStepping(s, delta, threads);
+		break;
+	default:
+		dijkstraHeap(s);
+	}
+}
+
+// Dijktras algorithm, O(V^2)
+void Digraph::dijkstraScan(int s)
+{
+	const CSR &G = adjacency();
+
 	dist[s] = 0;
 	done[s] = true;
 
 	while (true)
 	{
-		Node *p = array[s].getFirst();
-
-		while (p != nullptr)
+		for (int e = G.begin(s); e < G.end(s); e++)
 		{
-			if (done[p->vertex] == false && dist[p->vertex] > dist[s] + p->weight)
+			int u = G.vertex(e);
+
+			if (done[u] == false && dist[u] > dist[s] + G.weight(e))
 			{
-				dist[p->vertex] = dist[s] + p->weight;
-				path[p->vertex] = s;
+				dist[u] = dist[s] + G.weight(e);
+				path[u] = s;
 			}
-
-			p = array[s].getNext();
 		}
 
 		int smallest = INF;
@@ -148,6 +387,430 @@ void Digraph::pwsssp(int s)
 	}
 }
 
+// Dijkstra's algorithm, O((V+E) log V)
+// vertices are settled in the same order as by dijkstraScan,
+// ties in dist broken by the smaller vertex
+void Digraph::dijkstraHeap(int s)
+{
+	const CSR &G = adjacency();
+	IndexHeap H(size);
+
+	dist[s] = 0;
+	H.insert(s, 0);
+
+	while (!H.isEmpty())
+	{
+		int v = H.deleteMin();
+		done[v] = true;
+
+		for (int e = G.begin(v); e < G.end(v); e++)
+		{
+			int u = G.vertex(e);
+
+			if (done[u] == false && dist[u] > dist[v] + G.weight(e))
+			{
+				dist[u] = dist[v] + G.weight(e);
+				path[u] = v;
+				H.insert(u, dist[u]);
+			}
+		}
+	}
+}
+
+// Dijkstra's algorithm with Dial's bucket queue, O(E + V + D)
+// Tentative distances lie in [d, d + C] while bucket d is processed,
+// so C+1 buckets indexed by dist % (C+1) suffice.
+// A vertex is added again whenever dist decreases,
+// and entries that no longer match dist are skipped.
+// The vertices of a bucket are settled in any order. Instead, an edge
+// (v, u) that gives dist[u] again replaces path[u] if v is smaller and
+// was settled at the same distance, so path[u] is the vertex of smallest
+// (dist, vertex) on a shortest path to u, as from dijkstraScan.
+// With zero weights, that vertex may be settled after u, and path can
+// then differ from dijkstraScan; dist is always the same.
+void Digraph::dijkstraBuckets(int s)
+{
+	const CSR &G = adjacency();
+	int C = G.maxWeight() + 1;
+	vector<vector<int>> bucket(C);
+	vector<int> current;
+	int pending = 1;
+
+	dist[s] = 0;
+	bucket[0].push_back(s);
+
+	for (int d = 0; pending > 0 && d < INF; d++)
+	{
+		// zero weight edges add to bucket d while it is processed
+		while (!bucket[d % C].empty())
+		{
+			current.swap(bucket[d % C]);
+			pending -= (int)current.size();
+
+			for (int v : current)
+			{
+				if (done[v] == true || dist[v] != d) continue;
+				done[v] = true;
+
+				for (int e = G.begin(v); e < G.end(v); e++)
+				{
+					int u = G.vertex(e);
+
+					if (done[u] == true) continue;
+
+					if (dist[u] > d + G.weight(e))
+					{
+						dist[u] = d + G.weight(e);
+						path[u] = v;
+						bucket[dist[u] % C].push_back(u);
+						pending++;
+					}
+					else if (dist[u] == d + G.weight(e) && dist[path[u]] == d && v < path[u])
+					{
+						path[u] = v;
+					}
+				}
+			}
+
+			current.clear();
+		}
+	}
+}
+
+// Delta-stepping (Meyer and Sanders), with buckets of width delta.
+// Edges of weight at most delta are light, the others heavy.
+// Bucket i holds the vertices with tentative distance in
+// [i * delta, (i + 1) * delta). While bucket i is not empty, its
+// vertices are removed and their light edges relaxed by all threads,
+// which may put vertices back into bucket i. Then the heavy edges of
+// all vertices removed from bucket i are relaxed, also in parallel.
+// Relaxations lower the distance with an atomic min, and the threads
+// collect the vertices they improved, which are then put into their
+// buckets. Stale bucket entries are skipped.
+//
+// When the distances are known, path[u] is set to the vertex v with
+// smallest (dist[v], v) among those with dist[v] + w(v, u) = dist[u].
+// This is the vertex that Dijkstra's algorithm settles first, so
+// dist and path are the same as from the other methods.
+void Digraph::deltaStepping(int s, int delta, int threads)
+{
+	const CSR &G = adjacency();
+	const CSR &R = reverseAdjacency();
+
+	if (delta <= 0)
+	{
+		// about the largest weight divided by the average degree
+		delta = (int)((long long)G.maxWeight() * size / (G.edges() + 1));
+		if (delta < 1) delta = 1;
+	}
+
+	vector<atomic<int>> tent(size + 1);
+	vector<int> mark(size + 1, -1);      // last pass that took the vertex
+	vector<int> taken(size + 1, -1);     // last bucket that took the vertex
+	vector<vector<int>> bucket((INF - 1) / delta + 1);
+	vector<vector<int>> improved(threads);
+	vector<int> current;
+	vector<int> settled;
+	ThreadPool pool(threads);
+
+	for (int v = 0; v <= size; v++) tent[v] = INF;
+	tent[s] = 0;
+	bucket[0].push_back(s);
+
+	// relax the light or heavy edges out of vertices[0..n-1] in parallel
+	auto relax = [&](const vector<int> &vertices, bool light) {
+		pool.run((int)vertices.size(), [&](int t, int lo, int hi) {
+			for (int i = lo; i < hi; i++)
+			{
+				int v = vertices[i];
+				int d = tent[v].load(memory_order_relaxed);
+
+				for (int e = G.begin(v); e < G.end(v); e++)
+				{
+					int w = G.weight(e);
+					if ((w <= delta) != light) continue;
+
+					int u = G.vertex(e);
+					int old = tent[u].load(memory_order_relaxed);
+
+					while (d + w < old)
+					{
+						if (tent[u].compare_exchange_weak(old, d + w, memory_order_relaxed))
+						{
+							improved[t].push_back(u);
+							break;
+						}
+					}
+				}
+			}
+		});
+
+		for (vector<int> &l : improved)
+		{
+			for (int u : l)
+			{
+				bucket[tent[u].load(memory_order_relaxed) / delta].push_back(u);
+			}
+			l.clear();
+		}
+	};
+
+	int pass = 0;
+
+	for (int i = 0; i < (int)bucket.size(); i++)
+	{
+		settled.clear();
+
+		while (!bucket[i].empty())
+		{
+			current.clear();
+
+			for (int v : bucket[i])
+			{
+				int d = tent[v].load(memory_order_relaxed);
+
+				if (d / delta == i && mark[v] != pass)
+				{
+					if (taken[v] != i) settled.push_back(v);
+					taken[v] = i;
+					mark[v] = pass;
+					current.push_back(v);
+				}
+			}
+
+			bucket[i].clear();
+			pass++;
+			relax(current, true);
+		}
+
+		relax(settled, false);
+	}
+
+	pool.run(size, [&](int, int lo, int hi) {
+		for (int u = lo + 1; u <= hi; u++)
+		{
+			dist[u] = tent[u].load(memory_order_relaxed);
+			done[u] = dist[u] < INF;
+			path[u] = 0;
+
+			if (u == s || dist[u] == INF) continue;
+
+			int best = INF;
+
+			for (int e = R.begin(u); e < R.end(u); e++)
+			{
+				int v = R.vertex(e);
+				int d = tent[v].load(memory_order_relaxed);
+
+				if (d + R.weight(e) == dist[u] && (d < best || (d == best && v < path[u])))
+				{
+					best = d;
+					path[u] = v;
+				}
+			}
+		}
+	});
+}
+
+// shortest path from s to t by bidirectional Dijkstra
+// The search from s settles vertices in order of distance from s,
+// the search from t in order of distance to t over the reversed edges.
+// The side whose next vertex is closer is expanded. Whenever a vertex
+// has been reached from both sides, the path through it is a candidate.
+// No shorter path exists once the two next distances add up to at
+// least the best candidate.
+int Digraph::shortestPath(int s, int t)
+{
+	if (!startQuery(s, t)) return -1;
+
+	const CSR &G = adjacency();
+	const CSR &R = reverseAdjacency();
+	int best = INF;   // length of the best path found
+	int meet = 0;     // a vertex on it
+
+	forward.update(s, 0, 0, 0);
+	backward.update(t, 0, 0, 0);
+
+	if (s == t)
+	{
+		best = 0;
+		meet = s;
+	}
+
+	while (!forward.heap.isEmpty() && !backward.heap.isEmpty() &&
+		forward.heap.minKey() + backward.heap.minKey() < best)
+	{
+		bool fromS = forward.heap.minKey() <= backward.heap.minKey();
+		Search &a = fromS ? forward : backward;
+		Search &b = fromS ? backward : forward;
+		const CSR &E = fromS ? G : R;
+
+		int v = a.heap.deleteMin();
+
+		for (int e = E.begin(v); e < E.end(v); e++)
+		{
+			int u = E.vertex(e);
+			int d = a.dist[v] + E.weight(e);
+
+			if (d < a.dist[u])
+			{
+				a.update(u, d, v, d);
+			}
+
+			if (b.dist[u] < INF && a.dist[u] + b.dist[u] < best)
+			{
+				best = a.dist[u] + b.dist[u];
+				meet = u;
+			}
+		}
+	}
+
+	if (best == INF)
+	{
+		dist[t] = INF;
+		path[t] = 0;
+		return -1;
+	}
+
+	return setPath(meet, t);
+}
+
+// shortest path from s to t by A* search with heuristic h
+// Vertices are taken in order of dist + h. Since h may be admissible
+// without being consistent, a vertex is queued again whenever its
+// dist decreases, and the search stops when t is taken.
+int Digraph::shortestPath(int s, int t, const function<int(int)> &h)
+{
+	if (!startQuery(s, t)) return -1;
+
+	const CSR &G = adjacency();
+
+	forward.update(s, 0, 0, h(s));
+
+	while (!forward.heap.isEmpty())
+	{
+		int v = forward.heap.deleteMin();
+
+		if (v == t)
+		{
+			return setPath(t, t);
+		}
+
+		for (int e = G.begin(v); e < G.end(v); e++)
+		{
+			int u = G.vertex(e);
+			int d = forward.dist[v] + G.weight(e);
+
+			if (d < forward.dist[u])
+			{
+				forward.update(u, d, v, d + h(u));
+			}
+		}
+	}
+
+	dist[t] = INF;
+	path[t] = 0;
+	return -1;
+}
+
+// check s and t, and reset the searches for a new query
+bool Digraph::startQuery(int s, int t)
+{
+	if (s < 1 || s > size)
+	{
+		cout << "\nERROR: expected source s in range 1.." << size << " !" << endl;
+		return false;
+	}
+
+	if (t < 1 || t > size)
+	{
+		cout << "\nERROR: expected target t in range 1.." << size << " !" << endl;
+		return false;
+	}
+
+	forward.reset();
+	backward.reset();
+	return true;
+}
+
+// copy the path through m into dist and path, where
+// forward.path leads back from m to s and backward.path on to t
+int Digraph::setPath(int m, int t)
+{
+	for (int v = m; v != 0; v = forward.path[v])
+	{
+		dist[v] = forward.dist[v];
+		path[v] = forward.path[v];
+	}
+
+	for (int v = m; v != t; v = backward.path[v])
+	{
+		int u = backward.path[v];
+		dist[u] = dist[v] + backward.dist[v] - backward.dist[u];
+		path[u] = v;
+	}
+
+	return dist[t];
+}
+
+Digraph::Search::Search(int n)
+	: dist(n + 1, INF), path(n + 1, 0), heap(n)
+{
+}
+
+// restore dist, path and heap to their initial state
+void Digraph::Search::reset()
+{
+	for (int v : touched)
+	{
+		dist[v] = INF;
+		path[v] = 0;
+	}
+
+	touched.clear();
+	heap.makeEmpty();
+}
+
+// set dist[v] = d and path[v] = p, and queue v with key k
+void Digraph::Search::update(int v, int d, int p, int k)
+{
+	if (dist[v] == INF)
+	{
+		touched.push_back(v);
+	}
+
+	dist[v] = d;
+	path[v] = p;
+	heap.insert(v, k);
+}
+
+// CSR copy of the adjacency lists, rebuilt after edges have changed
+const CSR & Digraph::adjacency()
+{
+	if (dirty)
+	{
+		csr.build(array, size);
+		dirty = false;
+		rdirty = true;
+	}
+
+	return csr;
+}
+
+// CSR of the reverse graph, with the edges into each vertex
+const CSR & Digraph::reverseAdjacency()
+{
+	const CSR &G = adjacency();
+
+	if (rdirty)
+	{
+		rcsr.transpose(G);
+		rdirty = false;
+	}
+
+	return rcsr;
+}
+
 // print graph
 void Digraph::printGraph() const
 {
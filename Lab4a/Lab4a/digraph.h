@@ -6,11 +6,37 @@
 #ifndef DIGRAPH_H
 #define DIGRAPH_H
 
+#include <vector>
+#include <functional>
+
+using namespace std;
+
 #include "list.h"
+#include "csr.h"
+#include "indexheap.h"
 
 class Digraph
 {
 public:
+	// -- TYPES
+
+	// algorithms for pwsssp
+	// SCAN: O(V^2), selects the next vertex by scanning all vertices
+	// HEAP: O((V+E) log V), with an indexed heap and decrease-key
+	// BUCKET: O(E + V + D) for D the largest distance, with Dial's
+	//         circular array of C+1 buckets for C the largest weight
+	// DELTA: parallel delta-stepping, for weights of at least 1;
+	//        used only when asked for
+	// AUTO: BUCKET if all weights are in 1..BucketLimit,
+	//       else SCAN if at least half of all edges are present,
+	//       else HEAP
+	enum Method { AUTO, SCAN, HEAP, BUCKET, DELTA };
+
+	static const int BucketLimit = 256;
+
+	// uwsssp and pwsssp run in parallel only for graphs with at least this many edges
+	static const int ParallelLimit = 1 << 16;
+
 	// -- CONSTRUCTORS
 	explicit Digraph(int n);
 
@@ -27,10 +53,27 @@ public:
 	void removeEdge(int u, int v);
 
 	// unweighted single source shortest paths
-	void uwsssp(int s);
+	// threads = 0 chooses the number of threads from the graph size,
+	// threads = 1 runs the sequential breadth-first search
+	// in parallel, dist is the same but path may be another shortest path tree
+	void uwsssp(int s, int threads = 0);
 
 	// positive weighted single source shortest pats
-	void pwsssp(int s);
+	// delta is the bucket width of DELTA, 0 chooses it from the graph;
+	// threads as for uwsssp, DELTA with one thread runs AUTO instead
+	void pwsssp(int s, Method m = AUTO, int delta = 0, int threads = 0);
+
+	// shortest path from s to t by bidirectional Dijkstra,
+	// searching from s and, over the reversed edges, from t
+	// until the two searches meet;
+	// returns the length of the path, or -1 if there is none
+	// afterwards printPath(t) prints the path, but dist and path
+	// are set only for the vertices on it
+	int shortestPath(int s, int t);
+
+	// as above, by A* search from s guided by the heuristic h,
+	// where h(v) must not exceed the distance from v to t
+	int shortestPath(int s, int t, const function<int(int)> &h);
 
 	// print graph
 	void printGraph() const;
@@ -44,12 +87,64 @@ public:
 	//void printHelp(int t) const;
 
 private:
+	// -- TYPES
+
+	// one direction of a point-to-point search, kept between
+	// queries and reset only where the previous query changed it
+	struct Search
+	{
+		explicit Search(int n);
+
+		// restore dist, path and heap to their initial state
+		void reset();
+
+		// set dist[v] = d and path[v] = p, and queue v with key k
+		void update(int v, int d, int p, int k);
+
+		vector<int> dist;
+		vector<int> path;
+		vector<int> touched;
+		IndexHeap heap;
+	};
+
+	// -- MEMBER FUNCTIONS
+
+	// CSR copy of the adjacency lists, rebuilt after edges have changed
+	const CSR & adjacency();
+
+	// CSR of the reverse graph, with the edges into each vertex
+	const CSR & reverseAdjacency();
+
+	// breadth-first search from s, dist and path initialized
+	void bfsQueue(int s);
+	void bfsParallel(int s, int threads);
+
+	// Dijkstra's algorithm from s, dist, path and done initialized
+	void dijkstraScan(int s);
+	void dijkstraHeap(int s);
+	void dijkstraBuckets(int s);
+	void deltaStepping(int s, int delta, int threads);
+
+	// check s and t, and reset the searches for a new query
+	bool startQuery(int s, int t);
+
+	// copy the path through m into dist and path, where
+	// forward.path leads back from m to s and backward.path on to t;
+	// returns the length of the path
+	int setPath(int m, int t);
+
 	// -- DATA MEMBERS
 	List *array;
+	CSR  csr;
+	CSR  rcsr;
+	bool dirty;
+	bool rdirty;
 	int  *dist;
 	int  *path;
 	bool *done;
 	int  size;
+	Search forward;
+	Search backward;
 };
 
 #endif
@@ -0,0 +1,176 @@
+/*********************************************
+* file:	~\tnd004\lab\lab4a\indexheap.h       *
+* remark: indexed 4-ary heap of vertices     *
+**********************************************/
+
+#ifndef INDEXHEAP_H
+#define INDEXHEAP_H
+
+#include <vector>
+#include <cassert>
+
+using namespace std;
+
+// Min-heap of the vertices 1..n, each with an int key.
+// The key of a vertex in the heap can be decreased in O(log n),
+// since the position of every vertex in the heap is recorded.
+// Vertices with equal keys leave the heap in increasing order,
+// so the order of deleteMin does not depend on the insertion order.
+
+class IndexHeap
+{
+public:
+	// -- CONSTRUCTORS
+	explicit IndexHeap(int n);
+
+	// -- MEMBER FUNCTIONS
+
+	void makeEmpty();
+	bool isEmpty() const;
+
+	// is vertex v in the heap
+	bool contains(int v) const;
+
+	// insert vertex v with key k,
+	// or decrease the key of v to k if v is present
+	void insert(int v, int k);
+
+	// remove and return the vertex with smallest key
+	int deleteMin();
+
+	// smallest key
+	int minKey() const;
+
+private:
+	// -- MEMBER FUNCTIONS
+	bool less(int a, int b) const;
+	void siftUp(int i);
+	void siftDown(int i);
+
+	// -- DATA MEMBERS
+	vector<int> heap;   // heap[0] is the root, children of i at 4i+1..4i+4
+	vector<int> pos;    // index of vertex v in heap, or -1
+	vector<int> key;    // key of vertex v
+};
+
+// -- CONSTRUCTORS
+
+inline IndexHeap::IndexHeap(int n)
+	: pos(n + 1, -1), key(n + 1, 0)
+{
+	assert(n >= 0);
+}
+
+// -- MEMBER FUNCTIONS
+
+// O(number of vertices in the heap)
+inline void IndexHeap::makeEmpty()
+{
+	for (int v : heap)
+	{
+		pos[v] = -1;
+	}
+
+	heap.clear();
+}
+
+inline bool IndexHeap::isEmpty() const
+{
+	return heap.empty();
+}
+
+inline bool IndexHeap::contains(int v) const
+{
+	return pos[v] >= 0;
+}
+
+inline void IndexHeap::insert(int v, int k)
+{
+	if (pos[v] < 0)
+	{
+		pos[v] = (int)heap.size();
+		heap.push_back(v);
+	}
+	else
+	{
+		assert(k <= key[v]);
+	}
+
+	key[v] = k;
+	siftUp(pos[v]);
+}
+
+inline int IndexHeap::deleteMin()
+{
+	assert(!isEmpty());
+
+	int v = heap[0];
+	pos[v] = -1;
+
+	int last = heap.back();
+	heap.pop_back();
+
+	if (!heap.empty())
+	{
+		heap[0] = last;
+		pos[last] = 0;
+		siftDown(0);
+	}
+
+	return v;
+}
+
+inline int IndexHeap::minKey() const
+{
+	assert(!isEmpty());
+	return key[heap[0]];
+}
+
+// smaller key first, ties broken by vertex number
+inline bool IndexHeap::less(int a, int b) const
+{
+	return key[a] < key[b] || (key[a] == key[b] && a < b);
+}
+
+inline void IndexHeap::siftUp(int i)
+{
+	int v = heap[i];
+
+	while (i > 0 && less(v, heap[(i - 1) / 4]))
+	{
+		heap[i] = heap[(i - 1) / 4];
+		pos[heap[i]] = i;
+		i = (i - 1) / 4;
+	}
+
+	heap[i] = v;
+	pos[v] = i;
+}
+
+inline void IndexHeap::siftDown(int i)
+{
+	int v = heap[i];
+	int n = (int)heap.size();
+
+	while (4 * i + 1 < n)
+	{
+		int c = 4 * i + 1;
+		int last = (c + 4 < n) ? c + 4 : n;
+
+		for (int j = c + 1; j < last; j++)
+		{
+			if (less(heap[j], heap[c])) c = j;
+		}
+
+		if (!less(heap[c], v)) break;
+
+		heap[i] = heap[c];
+		pos[heap[i]] = i;
+		i = c;
+	}
+
+	heap[i] = v;
+	pos[v] = i;
+}
+
+#endif
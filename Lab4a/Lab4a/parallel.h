@@ -0,0 +1,157 @@
+/*********************************************
+* file:	~\tnd004\lab\lab4a\parallel.h        *
+* remark: thread pool for parallel loops     *
+**********************************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+// number of threads to use, at least 1
+inline int hardwareThreads()
+{
+	int n = (int)thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+// A fixed set of threads that run parallel loops.
+// The threads are started once, by the constructor, and then wait
+// for the next loop, so a loop costs a wake-up instead of a thread
+// creation per thread. The calling thread runs the first chunk.
+
+class ThreadPool
+{
+public:
+	// -- CONSTRUCTORS
+	explicit ThreadPool(int threads);
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+
+	// -- DESTRUCTOR
+	~ThreadPool();
+
+	// -- MEMBER FUNCTIONS
+
+	// number of threads, including the calling thread
+	int threads() const { return (int)workers.size() + 1; }
+
+	// split [0, n) into at most threads() contiguous chunks and call
+	// f(t, lo, hi) for chunk t = [lo, hi), each chunk on its own thread;
+	// returns when all chunks are done
+	template <class Function>
+	void run(int n, Function f);
+
+private:
+	// -- MEMBER FUNCTIONS
+
+	// loop of worker thread t
+	void work(int t);
+
+	// -- DATA MEMBERS
+	vector<thread> workers;
+	mutex lock;
+	condition_variable start;
+	condition_variable finish;
+	function<void(int, int, int)> task;
+	int count;         // n of the current loop
+	int chunks;        // chunks of the current loop
+	int busy;          // workers not yet done with the current loop
+	long long round;   // number of loops started
+	bool stop;
+};
+
+// -- CONSTRUCTORS
+
+inline ThreadPool::ThreadPool(int threads)
+	: count(0), chunks(0), busy(0), round(0), stop(false)
+{
+	for (int t = 1; t < threads; t++)
+	{
+		workers.emplace_back(&ThreadPool::work, this, t);
+	}
+}
+
+// -- DESTRUCTOR
+
+inline ThreadPool::~ThreadPool()
+{
+	{
+		unique_lock<mutex> guard(lock);
+		stop = true;
+	}
+
+	start.notify_all();
+
+	for (thread &w : workers)
+	{
+		w.join();
+	}
+}
+
+// -- MEMBER FUNCTIONS
+
+template <class Function>
+void ThreadPool::run(int n, Function f)
+{
+	int c = (threads() < n) ? threads() : n;
+
+	if (c <= 1)
+	{
+		if (n > 0) f(0, 0, n);
+		return;
+	}
+
+	{
+		unique_lock<mutex> guard(lock);
+		task = f;
+		count = n;
+		chunks = c;
+		busy = (int)workers.size();
+		round++;
+	}
+
+	start.notify_all();
+
+	f(0, 0, (int)((long long)n / c));
+
+	unique_lock<mutex> guard(lock);
+	finish.wait(guard, [this] { return busy == 0; });
+	task = nullptr;
+}
+
+inline void ThreadPool::work(int t)
+{
+	long long seen = 0;
+
+	while (true)
+	{
+		unique_lock<mutex> guard(lock);
+		start.wait(guard, [&] { return stop || round != seen; });
+
+		if (stop) return;
+
+		seen = round;
+		int n = count;
+		int c = chunks;
+		guard.unlock();
+
+		if (t < c)
+		{
+			task(t, (int)((long long)n * t / c), (int)((long long)n * (t + 1) / c));
+		}
+
+		guard.lock();
+		if (--busy == 0) finish.notify_one();
+	}
+}
+
+#endif
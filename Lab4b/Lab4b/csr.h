@@ -0,0 +1,82 @@
+/*********************************************
+* file:	~\tnd004\lab\lab4b\csr.h             *
+* remark: compressed sparse row adjacency    *
+**********************************************/
+
+#ifndef CSR_H
+#define CSR_H
+
+#include <vector>
+
+using namespace std;
+
+#include "list.h"
+
+// The edges (v, w) of vertex v are stored at positions
+// begin(v) .. end(v)-1 of the contiguous arrays targets and weights,
+// in the same order as in the adjacency list of v.
+// Traversing all edges thus reads memory sequentially,
+// instead of following one heap allocated node per edge.
+
+class CSR
+{
+public:
+	// -- CONSTRUCTORS
+	CSR() : size(0) { }
+
+	// -- MEMBER FUNCTIONS
+
+	// rebuild from the adjacency lists array[1..n]
+	void build(List *array, int n);
+
+	// first edge of vertex v
+	int begin(int v) const { return offsets[v]; }
+
+	// one past the last edge of vertex v
+	int end(int v) const { return offsets[v + 1]; }
+
+	// head vertex of edge e
+	int vertex(int e) const { return targets[e]; }
+
+	// weight of edge e
+	int weight(int e) const { return weights[e]; }
+
+	// number of vertices
+	int vertices() const { return size; }
+
+	// number of edges
+	int edges() const { return (int)targets.size(); }
+
+private:
+	// -- DATA MEMBERS
+	vector<int> offsets;   // offsets[1..size+1]
+	vector<int> targets;
+	vector<int> weights;
+	int size;
+};
+
+// -- MEMBER FUNCTIONS
+
+// rebuild from the adjacency lists array[1..n]
+inline void CSR::build(List *array, int n)
+{
+	size = n;
+	offsets.assign(n + 2, 0);
+	targets.clear();
+	weights.clear();
+
+	for (int v = 1; v <= n; v++)
+	{
+		offsets[v] = (int)targets.size();
+
+		for (Node *p = array[v].getFirst(); p != nullptr; p = array[v].getNext())
+		{
+			targets.push_back(p->vertex);
+			weights.push_back(p->weight);
+		}
+	}
+
+	offsets[n + 1] = (int)targets.size();
+}
+
+#endif
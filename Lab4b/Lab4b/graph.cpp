@@ -28,6 +28,7 @@ Graph::Graph(int n)
 	path = new int[n + 1];
 	done = new bool[n + 1];
 	size = n;
+	dirty = true;
 }
 
 // -- DESTRUCTOR
@@ -47,6 +48,7 @@ void Graph::insertEdge(int u, int v, int w)
 	assert(v >= 1 && v <= size);
 	array[u].insert(v, w);
 	array[v].insert(u, w);
+	dirty = true;
 }
 
 // remove undirected edge (u, v)
@@ -56,11 +58,14 @@ void Graph::removeEdge(int u, int v)
 	assert(v >= 1 && v <= size);
 	array[u].remove(v);
 	array[v].remove(u);
+	dirty = true;
 }
 
 // Prim's minimum spanning tree algorithm
 void Graph::mstPrim() const
 {
+	const CSR &G = adjacency();
+
 	for (int i = 1; i <= size; ++i)
 	{
 		dist[i] = INF;
@@ -75,17 +80,15 @@ void Graph::mstPrim() const
 
 	while (true)
 	{
-		Node *p = array[v].getFirst();
-
-		while (p != nullptr)
+		for (int e = G.begin(v); e < G.end(v); e++)
 		{
-			if (done[p->vertex] == false && dist[p->vertex] > p->weight)
+			int u = G.vertex(e);
+
+			if (done[u] == false && dist[u] > G.weight(e))
 			{
-				dist[p->vertex] = p->weight;
-				path[p->vertex] = v;
+				dist[u] = G.weight(e);
+				path[u] = v;
 			}
-
-			p = array[v].getNext();
 		}
 
 		int smallest = INF;
@@ -111,21 +114,20 @@ void Graph::mstPrim() const
 // Kruskal's minimum spanning tree algorithm
 void Graph::mstKruskal() const
 {
-	Heap<Edge> H;
+	const CSR &G = adjacency();
+
+	Heap<Edge> H(G.edges() / 2 + 1);
 
 	DSets D(size);
 
 	for (int i = 1; i <= size; i++)
 	{
-		Node* N = array[i].getFirst();
-
-		while (N != nullptr)
+		for (int e = G.begin(i); e < G.end(i); e++)
 		{
-			if (N->vertex > i) {
-				Edge E(i, N->vertex, N->weight);
+			if (G.vertex(e) > i) {
+				Edge E(i, G.vertex(e), G.weight(e));
 				H.insert(E);
 			}
-			N = N->next;
 		}
 	}
 
@@ -149,6 +151,18 @@ void Graph::mstKruskal() const
 	cout << "Total weight = " << weightCount << endl;
 }
 
+// CSR copy of the adjacency lists, rebuilt after edges have changed
+const CSR & Graph::adjacency() const
+{
+	if (dirty)
+	{
+		csr.build(array, size);
+		dirty = false;
+	}
+
+	return csr;
+}
+
 // print graph
 void Graph::printGraph() const
 {
@@ -7,6 +7,7 @@
 #define GRAPH_H
 
 #include "list.h"
+#include "csr.h"
 
 class Graph
 {
@@ -36,8 +37,15 @@ public:
 	void printGraph() const;
 
 private:
+	// -- MEMBER FUNCTIONS
+
+	// CSR copy of the adjacency lists, rebuilt after edges have changed
+	const CSR & adjacency() const;
+
 	// -- DATA MEMBERS
 	List *array;
+	mutable CSR  csr;
+	mutable bool dirty;
 	int* dist;
 	int* path;
 	bool* done;